@@ -0,0 +1,270 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <cassert>
+#include <iterator>
+#include <mutex>
+
+// Process-wide slab storage addressed by 32-bit indices.
+// Slots live in fixed-size blocks that never move, so an index (and any
+// reference into its slot) stays valid until the slot is released.
+// Every container allocating from the arena threads its slots on an
+// intrusive Chain: iteration follows the chain, and handing all slots of
+// one container over to another is a constant-time chain splice.
+// Released slots go to a free chain and are reused without destruction.
+//
+// Containers may be filled from several threads at once: each thread
+// carves fresh slots out of whole blocks reserved for it and keeps its
+// own free chain, so only reserving a block takes the lock. A container
+// must not be used by two threads at the same time, and handing it over
+// needs the usual synchronisation (joining the thread, a future, ...).
+//
+// Block requirements:
+//   static constexpr unsigned shift;  // log2 of slots per block
+//   ArenaLink links[1 << shift];
+struct ArenaLink {
+	std::uint32_t prev;
+	std::uint32_t next;
+};
+
+template <class Block>
+class Arena
+{
+public:
+	using Index = std::uint32_t;
+	static constexpr Index null = ~Index{0};
+	static constexpr unsigned shift = Block::shift;
+	static constexpr Index slots = Index{1} << shift;
+	static constexpr std::size_t maxBlocks = std::size_t{1} << (30 - shift);
+
+	using Link = ArenaLink;
+
+	class Chain
+	{
+	public:
+		Index head{null};
+		Index tail{null};
+		std::size_t count{};
+
+		void push_back(Index i);
+		void unlink(Index i);
+		void splice(Chain& other); // appends other, leaves it empty
+	};
+
+	static Block& block(Index i) { return *table[i >> shift]; }
+	static Index offset(Index i) { return i & (slots - 1); }
+	static Link& link(Index i) { return block(i).links[offset(i)]; }
+
+	static Index acquire(Chain& owner);
+	static void release(Chain& owner, Index i);
+	static void release(Chain& owner);
+private:
+	// per-thread state: the unused rest of the thread's current block and
+	// the slots released by the thread; both are handed back to the shared
+	// free chain when the thread exits
+	struct Local {
+		Index next{};
+		Index limit{};
+		Chain free;
+		~Local();
+	};
+	static Local& local();
+	static void refill(Local&);
+
+	static std::unique_ptr<Block> table[maxBlocks];
+	static std::size_t blocks; // blocks reserved so far
+	static Chain shared;
+	static std::mutex mutex;
+};
+
+template <class Block>
+std::unique_ptr<Block> Arena<Block>::table[Arena<Block>::maxBlocks];
+
+template <class Block>
+std::size_t Arena<Block>::blocks = 0;
+
+template <class Block>
+typename Arena<Block>::Chain Arena<Block>::shared;
+
+template <class Block>
+std::mutex Arena<Block>::mutex;
+
+// Chain
+template <class Block>
+void Arena<Block>::Chain::push_back(Index i)
+{
+	link(i) = Link{tail, null};
+	if (tail == null)
+		head = i;
+	else
+		link(tail).next = i;
+	tail = i;
+	++count;
+}
+
+template <class Block>
+void Arena<Block>::Chain::unlink(Index i)
+{
+	Link l = link(i);
+	if (l.prev == null)
+		head = l.next;
+	else
+		link(l.prev).next = l.next;
+	if (l.next == null)
+		tail = l.prev;
+	else
+		link(l.next).prev = l.prev;
+	--count;
+}
+
+template <class Block>
+void Arena<Block>::Chain::splice(Chain& other)
+{
+	if (other.head == null)
+		return;
+	if (head == null) {
+		head = other.head;
+	}
+	else {
+		link(tail).next = other.head;
+		link(other.head).prev = tail;
+	}
+	tail = other.tail;
+	count += other.count;
+	other = Chain{};
+}
+
+// Arena
+template <class Block>
+Arena<Block>::Local::~Local()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	shared.splice(free);
+	while (next != limit)
+		shared.push_back(next++);
+}
+
+template <class Block>
+typename Arena<Block>::Local& Arena<Block>::local()
+{
+	static thread_local Local l;
+	return l;
+}
+
+template <class Block>
+void Arena<Block>::refill(Local& l)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (shared.head != null) {
+		l.free.splice(shared);
+		return;
+	}
+	assert(blocks < maxBlocks);
+	table[blocks].reset(new Block()); // zeroed
+	l.next = Index(blocks) << shift;
+	l.limit = l.next + slots;
+	// the last index is never handed out: a quad edge's record packs it
+	// as index << 2 | rotation, which would be the null record there
+	if (blocks == maxBlocks - 1)
+		--l.limit;
+	++blocks;
+}
+
+template <class Block>
+typename Arena<Block>::Index Arena<Block>::acquire(Chain& owner)
+{
+	Local& l = local();
+	if (l.free.head == null && l.next == l.limit)
+		refill(l);
+
+	Index i = l.free.head;
+	if (i != null)
+		l.free.unlink(i);
+	else
+		i = l.next++;
+	owner.push_back(i);
+	return i;
+}
+
+template <class Block>
+void Arena<Block>::release(Chain& owner, Index i)
+{
+	owner.unlink(i);
+	local().free.push_back(i);
+}
+
+template <class Block>
+void Arena<Block>::release(Chain& owner)
+{
+	local().free.splice(owner);
+}
+
+// Handle of an arena slot. It also steps along the owner's chain, so the
+// same type serves as the iterator of an ArenaStore; the null handle is
+// the end of every chain. Fields are reached through a Proxy of
+// references that Block::at(offset) builds.
+template <class Block, class Proxy>
+class ArenaRef
+{
+	using Storage = Arena<Block>;
+	std::uint32_t i;
+public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = Proxy;
+	using difference_type = std::ptrdiff_t;
+	using pointer = Proxy;
+	using reference = Proxy;
+
+	ArenaRef() : i{Storage::null} {}
+	explicit ArenaRef(std::uint32_t i_) : i{i_} {}
+
+	std::uint32_t index() const { return i; }
+	Proxy operator*() const { return Storage::block(i).at(Storage::offset(i)); }
+	Proxy operator->() const { return **this; }
+	ArenaRef& operator++() { i = Storage::link(i).next; return *this; }
+	ArenaRef operator++(int) { ArenaRef copy = *this; ++*this; return copy; }
+	bool operator==(ArenaRef const& other) const { return i == other.i; }
+	bool operator!=(ArenaRef const& other) const { return i != other.i; }
+	bool operator<(ArenaRef const& other) const { return i < other.i; }
+};
+
+// Owning chain of arena slots with the interface of a node-based list:
+// handles stay valid until erased, erase returns the slot to the free
+// list, and splice takes over another store's slots in constant time.
+// Block::clear(offset) resets a slot handed out by add().
+template <class Block, class Proxy>
+class ArenaStore
+{
+	using Storage = Arena<Block>;
+	typename Storage::Chain chain;
+public:
+	using Ref = ArenaRef<Block, Proxy>;
+
+	ArenaStore() = default;
+	ArenaStore(ArenaStore&& other) { chain.splice(other.chain); }
+	ArenaStore& operator=(ArenaStore&& other)
+	{
+		if (this != &other) {
+			Storage::release(chain);
+			chain.splice(other.chain);
+		}
+		return *this;
+	}
+	ArenaStore(ArenaStore const&) = delete;
+	ArenaStore& operator=(ArenaStore const&) = delete;
+	~ArenaStore() { Storage::release(chain); }
+
+	Ref add()
+	{
+		auto i = Storage::acquire(chain);
+		Storage::block(i).clear(Storage::offset(i));
+		return Ref(i);
+	}
+	void erase(Ref r) { Storage::release(chain, r.index()); }
+	void splice(ArenaStore& other) { chain.splice(other.chain); }
+	std::size_t size() const { return chain.count; }
+	Ref begin() const { return Ref(chain.head); }
+	Ref end() const { return Ref(); }
+	Ref back() const { return Ref(chain.tail); }
+};
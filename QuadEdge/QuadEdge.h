@@ -1,31 +1,54 @@
 #pragma once
-#include <list>
 #include <array>
+#include <cstdint>
+#include <iterator>
+#include "Arena.h"
 
+// Quad-edges are kept in a process-wide Arena and addressed by 32-bit
+// indices. A QuadEdgeList owns the chain of its quad-edges: deleteEdge
+// returns the slot to the arena's free list, merge splices chains.
 template <class T>
 class QuadEdgeList 
 {
 public:
 	class QuadEdge;
 	class EdgeRef;
-	using List = std::list<QuadEdge>;
-	using QuadEdgeRef = typename List::iterator;
+	class QuadEdgeRef;
+
+	QuadEdgeList() = default;
+	QuadEdgeList(QuadEdgeList&& other);
+	QuadEdgeList& operator=(QuadEdgeList&& other);
+	QuadEdgeList(QuadEdgeList const&) = delete;
+	QuadEdgeList& operator=(QuadEdgeList const&) = delete;
+	~QuadEdgeList();
 
 	EdgeRef makeEdge();
+	EdgeRef makeLoop();
 	void deleteEdge(EdgeRef);
 	std::size_t size() const;
 	QuadEdgeRef begin();
 	QuadEdgeRef end();
 	void merge(QuadEdgeList& other);
+	// Sets the Onext of e as it is, for loaders restoring a stored
+	// topology; unlike splice it keeps no invariant.
+	static void setOnext(EdgeRef e, EdgeRef next);
 private:
-	List quadEdges;
+	struct Block;
+	using Storage = Arena<Block>;
+	using Index = std::uint32_t;
+	static QuadEdge& quadEdge(Index);
+
+	typename Storage::Chain quadEdges;
 };
 
+// Packs the quad-edge index and the rotation into one word:
+// bits = index << 2 | rotation, so Rot/Sym/InvRot are bit operations.
 template <class T>
 class QuadEdgeList<T>::EdgeRef
 {
-	typename QuadEdgeList<T>::QuadEdgeRef qref;
-	int n;
+	std::uint32_t bits;
+	typename QuadEdgeList<T>::Index quadEdge() const;
+	typename QuadEdgeList<T>::QuadEdge::Record& record() const;
 public:
 	EdgeRef(typename QuadEdgeList<T>::QuadEdgeRef, int n=0);
 	EdgeRef(); // nullEdgeRef by default
@@ -43,15 +66,20 @@ public:
 	EdgeRef Dnext() const;
 	bool operator==(EdgeRef const& other) const;
 	bool operator!=(EdgeRef const& other) const;
+	bool operator<(EdgeRef const& other) const;
+	bool dual() const;
 	operator bool() const;
+	// the quad-edge and which of its records this is
+	QuadEdgeRef quadEdgeRef() const;
+	int rotation() const;
 	
 	friend QuadEdgeList;
 	friend void splice(typename QuadEdgeList<T>::EdgeRef a, typename QuadEdgeList<T>::EdgeRef b)
 	{
 		auto alpha = a.Onext().Rot();
 		auto beta = b.Onext().Rot();
-		std::swap(a.qref->recs[a.n].next, b.qref->recs[b.n].next);
-		std::swap(alpha.qref->recs[alpha.n].next, beta.qref->recs[beta.n].next);
+		std::swap(a.record().next, b.record().next);
+		std::swap(alpha.record().next, beta.record().next);
 	}
 };
 
@@ -65,7 +93,6 @@ public:
 	};
 	friend QuadEdgeList<T>;
 	friend QuadEdgeList<T>::EdgeRef;
-	friend void splice(typename QuadEdgeList<T>::EdgeRef a, typename QuadEdgeList<T>::EdgeRef b);
 private:
 	std::array<Record, 4> recs;
 public:
@@ -73,6 +100,39 @@ public:
 	std::array<Record, 4> const& records() const;
 };
 
+template <class T>
+struct QuadEdgeList<T>::Block
+{
+	static constexpr unsigned shift = 12;
+	std::array<QuadEdge, 1 << shift> quadEdges;
+	ArenaLink links[1 << shift];
+};
+
+// Forward iterator over the quad-edges owned by a list
+template <class T>
+class QuadEdgeList<T>::QuadEdgeRef
+{
+	typename QuadEdgeList<T>::Index q;
+public:
+	using iterator_category = std::forward_iterator_tag;
+	using value_type = QuadEdge;
+	using difference_type = std::ptrdiff_t;
+	using pointer = QuadEdge*;
+	using reference = QuadEdge&;
+
+	explicit QuadEdgeRef(typename QuadEdgeList<T>::Index q_ = QuadEdgeList<T>::Storage::null);
+	typename QuadEdgeList<T>::Index index() const;
+	QuadEdge& operator*() const;
+	QuadEdge* operator->() const;
+	QuadEdgeRef& operator++();
+	QuadEdgeRef operator++(int);
+	bool operator==(QuadEdgeRef const& other) const;
+	bool operator!=(QuadEdgeRef const& other) const;
+
+	friend QuadEdgeList;
+	friend EdgeRef;
+};
+
 
 // QuadEdge
 template <class T>
@@ -87,40 +147,103 @@ QuadEdgeList<T>::QuadEdge::records() const
 	return recs;
 }
 
+// QuadEdgeRef
+template <class T>
+QuadEdgeList<T>::QuadEdgeRef::QuadEdgeRef(typename QuadEdgeList<T>::Index q_)
+	: q{q_}
+{}
+
+template <class T>
+typename QuadEdgeList<T>::Index QuadEdgeList<T>::QuadEdgeRef::index() const
+{
+	return q;
+}
+
+template <class T>
+typename QuadEdgeList<T>::QuadEdge& QuadEdgeList<T>::QuadEdgeRef::operator*() const
+{
+	return QuadEdgeList<T>::quadEdge(q);
+}
+
+template <class T>
+typename QuadEdgeList<T>::QuadEdge* QuadEdgeList<T>::QuadEdgeRef::operator->() const
+{
+	return &QuadEdgeList<T>::quadEdge(q);
+}
+
+template <class T>
+typename QuadEdgeList<T>::QuadEdgeRef& QuadEdgeList<T>::QuadEdgeRef::operator++()
+{
+	q = QuadEdgeList<T>::Storage::link(q).next;
+	return *this;
+}
+
+template <class T>
+typename QuadEdgeList<T>::QuadEdgeRef QuadEdgeList<T>::QuadEdgeRef::operator++(int)
+{
+	QuadEdgeRef copy = *this;
+	++*this;
+	return copy;
+}
+
+template <class T>
+bool QuadEdgeList<T>::QuadEdgeRef::operator==(typename QuadEdgeList<T>::QuadEdgeRef const& other) const
+{
+	return q == other.q;
+}
+
+template <class T>
+bool QuadEdgeList<T>::QuadEdgeRef::operator!=(typename QuadEdgeList<T>::QuadEdgeRef const& other) const
+{
+	return q != other.q;
+}
+
 // EdgeRef 
 template <class T>
-QuadEdgeList<T>::EdgeRef::EdgeRef(typename QuadEdgeList<T>::QuadEdgeRef qref_, int n_=0)
-	: qref{qref_}, n{n_}
+QuadEdgeList<T>::EdgeRef::EdgeRef(typename QuadEdgeList<T>::QuadEdgeRef qref_, int n_)
+	: bits{qref_.q << 2 | std::uint32_t(n_)}
 {}
 
 template <class T>
 QuadEdgeList<T>::EdgeRef::EdgeRef()
-	: qref{}, n{-1}
+	: bits{~std::uint32_t{0}}
 {}
 
+template <class T>
+typename QuadEdgeList<T>::Index QuadEdgeList<T>::EdgeRef::quadEdge() const
+{
+	return bits >> 2;
+}
+
+template <class T>
+typename QuadEdgeList<T>::QuadEdge::Record& QuadEdgeList<T>::EdgeRef::record() const
+{
+	return QuadEdgeList<T>::quadEdge(quadEdge()).recs[bits & 3u];
+}
+
 template <class T>
 T& QuadEdgeList<T>::EdgeRef::data()
 {
-	return qref->recs[n].data;
+	return record().data;
 }
 
 template <class T>
 T const& QuadEdgeList<T>::EdgeRef::data() const
 {
-	return qref->recs[n].data;
+	return record().data;
 }
 
 template <class T>
 typename QuadEdgeList<T>::EdgeRef QuadEdgeList<T>::EdgeRef::Onext() const
 {
-	return qref->recs[n].next;
+	return record().next;
 }
 
 template <class T>
 typename QuadEdgeList<T>::EdgeRef QuadEdgeList<T>::EdgeRef::Rot() const
 {
 	typename QuadEdgeList<T>::EdgeRef copy = *this;
-	copy.n = (copy.n + 1) % 4;
+	copy.bits = (bits & ~3u) | ((bits + 1) & 3u);
 	return copy;
 }
 
@@ -128,7 +251,7 @@ template <class T>
 typename QuadEdgeList<T>::EdgeRef QuadEdgeList<T>::EdgeRef::InvRot() const
 {
 	typename QuadEdgeList<T>::EdgeRef copy = *this;
-	copy.n = (copy.n + 3) % 4;
+	copy.bits = (bits & ~3u) | ((bits - 1) & 3u);
 	return copy;
 }
 
@@ -136,7 +259,7 @@ template <class T>
 typename QuadEdgeList<T>::EdgeRef QuadEdgeList<T>::EdgeRef::Sym() const
 {
 	typename QuadEdgeList<T>::EdgeRef copy = *this;
-	copy.n = (copy.n + 2) % 4;
+	copy.bits = bits ^ 2u;
 	return copy;
 }
 
@@ -178,7 +301,7 @@ typename QuadEdgeList<T>::EdgeRef QuadEdgeList<T>::EdgeRef::Dnext() const
 
 template <class T>
 bool QuadEdgeList<T>::EdgeRef::operator==(typename QuadEdgeList<T>::EdgeRef const& other) const {
-	return this->qref == other.qref && this->n == other.n;
+	return this->bits == other.bits;
 }
 
 template <class T>
@@ -186,17 +309,65 @@ bool QuadEdgeList<T>::EdgeRef::operator!=(typename QuadEdgeList<T>::EdgeRef cons
 	return !(*this == other);
 }
 
+template <class T>
+bool QuadEdgeList<T>::EdgeRef::operator<(typename QuadEdgeList<T>::EdgeRef const& other) const {
+	return this->bits < other.bits;
+}
+
+// odd rotations belong to the dual subdivision
+template <class T>
+bool QuadEdgeList<T>::EdgeRef::dual() const {
+	return (bits & 1u) != 0;
+}
+
 template <class T>
 QuadEdgeList<T>::EdgeRef::operator bool() const {
-	return n >= 0;
+	return bits != ~std::uint32_t{0};
+}
+
+template <class T>
+typename QuadEdgeList<T>::QuadEdgeRef QuadEdgeList<T>::EdgeRef::quadEdgeRef() const {
+	return QuadEdgeRef(quadEdge());
+}
+
+template <class T>
+int QuadEdgeList<T>::EdgeRef::rotation() const {
+	return int(bits & 3u);
 }
 
 // QuadEdgeList
+template <class T>
+QuadEdgeList<T>::QuadEdgeList(QuadEdgeList<T>&& other)
+{
+	quadEdges.splice(other.quadEdges);
+}
+
+template <class T>
+QuadEdgeList<T>& QuadEdgeList<T>::operator=(QuadEdgeList<T>&& other)
+{
+	if (this != &other) {
+		Storage::release(quadEdges);
+		quadEdges.splice(other.quadEdges);
+	}
+	return *this;
+}
+
+template <class T>
+QuadEdgeList<T>::~QuadEdgeList()
+{
+	Storage::release(quadEdges);
+}
+
+template <class T>
+typename QuadEdgeList<T>::QuadEdge& QuadEdgeList<T>::quadEdge(Index q)
+{
+	return Storage::block(q).quadEdges[Storage::offset(q)];
+}
+
 template <class T>
 typename QuadEdgeList<T>::EdgeRef QuadEdgeList<T>::makeEdge()
 {
-	quadEdges.push_back(QuadEdge());
-	QuadEdgeRef qref = std::prev(quadEdges.end());
+	QuadEdgeRef qref(Storage::acquire(quadEdges));
 	qref->recs[0] = {EdgeRef(qref,0),T{}};
 	qref->recs[1] = {EdgeRef(qref,3),T{}};
 	qref->recs[2] = {EdgeRef(qref,2),T{}};
@@ -204,34 +375,53 @@ typename QuadEdgeList<T>::EdgeRef QuadEdgeList<T>::makeEdge()
 	return EdgeRef(qref, 0);
 }
 
+// the dual of makeEdge(): a loop at one vertex separating two faces,
+// with the primal records kept at even rotations
+template <class T>
+typename QuadEdgeList<T>::EdgeRef QuadEdgeList<T>::makeLoop()
+{
+	QuadEdgeRef qref(Storage::acquire(quadEdges));
+	qref->recs[0] = {EdgeRef(qref,2),T{}};
+	qref->recs[1] = {EdgeRef(qref,1),T{}};
+	qref->recs[2] = {EdgeRef(qref,0),T{}};
+	qref->recs[3] = {EdgeRef(qref,3),T{}};
+	return EdgeRef(qref, 0);
+}
+
 template<class T>
 void QuadEdgeList<T>::deleteEdge(typename QuadEdgeList<T>::EdgeRef e)
 {
 	splice(e, e.Oprev());
 	splice(e.Sym(), e.Sym().Oprev());
-	quadEdges.erase(e.qref);
+	Storage::release(quadEdges, e.quadEdge());
 }
 
 template<class T>
 std::size_t QuadEdgeList<T>::size() const
 {
-	return quadEdges.size();
+	return quadEdges.count;
 }
 
 template<class T>
 typename QuadEdgeList<T>::QuadEdgeRef QuadEdgeList<T>::begin()
 {
-	return quadEdges.begin();
+	return QuadEdgeRef(quadEdges.head);
 }
 
 template<class T>
 typename QuadEdgeList<T>::QuadEdgeRef QuadEdgeList<T>::end()
 {
-	return quadEdges.end();
+	return QuadEdgeRef();
 }
 
 template<class T>
 void QuadEdgeList<T>::merge(QuadEdgeList<T>& other)
 {
-	quadEdges.splice(quadEdges.end(), other.quadEdges);
+	quadEdges.splice(other.quadEdges);
+}
+
+template<class T>
+void QuadEdgeList<T>::setOnext(typename QuadEdgeList<T>::EdgeRef e, typename QuadEdgeList<T>::EdgeRef next)
+{
+	e.record().next = next;
 }
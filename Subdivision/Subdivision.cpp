@@ -1,24 +1,7 @@
 #include "Subdivision.h"
 
-Subdivision::VertexRef& Org(EdgeRef e) {
-	Subdivision::EdgeData& data = e.data();
-	return boost::get<std::list<Subdivision::Vertex>::iterator>(data.var);
-}
-
-Subdivision::VertexRef& Dest(EdgeRef e) {
-	Subdivision::EdgeData& data = e.Sym().data();
-	return boost::get<std::list<Subdivision::Vertex>::iterator>(data.var);
-}
-
-Subdivision::FaceRef& Left(EdgeRef e) {
-	Subdivision::EdgeData& data = e.InvRot().data();
-	return boost::get<std::list<Subdivision::Face>::iterator>(data.var);
-}
-
-Subdivision::FaceRef& Right(EdgeRef e) {
-	Subdivision::EdgeData& data = e.Rot().data();
-	return boost::get<std::list<Subdivision::Face>::iterator>(data.var);
-}
+std::atomic<std::uint64_t> Subdivision::VertexBlock::serials{0};
+std::atomic<std::uint64_t> Subdivision::FaceBlock::serials{0};
 
 void printEdge(EdgeRef e)
 {
@@ -36,18 +19,17 @@ Subdivision::Subdivision()
 
 Subdivision::Subdivision(Point p1, Point p2)
 {
-	vertices.push_back(Vertex{p1});
-	vertices.push_back(Vertex{p2});
+	VertexRef v1 = vertices.add();
+	VertexRef v2 = vertices.add();
+	v1->point = p1;
+	v2->point = p2;
 	
 	auto e = edges.makeEdge();
 
-	auto vert = vertices.begin();
-	
-	e.data() = EdgeData{{},{},vert};
-	vert->leaves = e;
-	++vert;
-	e.Sym().data() = EdgeData{{},{},vert};
-	vert->leaves = e.Sym();
+	Org(e) = v1;
+	v1->leaves = e;
+	Dest(e) = v2;
+	v2->leaves = e.Sym();
 
 	//for (VertexRef v = this->vertices.begin(); v != this->vertices.end(); ++v)
 	//{
@@ -59,11 +41,31 @@ Subdivision::Subdivision(Point p1, Point p2)
 }
 
 
+// appends 'from' to 'to'; serials follow list order in each, but halves
+// built on different threads draw them from the counter in turns, and then
+// the joined list is numbered afresh
+template <class Block, class Store>
+static void splice_serials(Store& to, Store& from)
+{
+	bool renumber = to.size() > 0 && from.size() > 0
+		&& to.back()->serial > from.begin()->serial;
+	to.splice(from);
+	if (!renumber)
+		return;
+	std::uint64_t serial = Block::serials.fetch_add(to.size());
+	for (auto r = to.begin(); r != to.end(); ++r)
+		r->serial = serial++;
+}
+
 void Subdivision::merge(Subdivision &other)
 {
 	edges.merge(other.edges);
-	vertices.splice(vertices.end(), other.vertices);
-	faces.splice(faces.end(), other.faces);
+	splice_serials<VertexBlock>(vertices, other.vertices);
+	splice_serials<FaceBlock>(faces, other.faces);
+	locator = Locator{};
+	other.locator = Locator{};
+	segments = Segments{};
+	other.segments = Segments{};
 
 	//for (VertexRef v = this->vertices.begin(); v != this->vertices.end(); ++v)
 	//{
@@ -110,13 +112,14 @@ EdgeRef Subdivision::add_vertex(EdgeRef e, Point p)
 	VertexRef eo = Org(e);
 	VertexRef ed = Dest(e);
 
-	vertices.push_back(Vertex{p});
-	auto vert = std::prev(vertices.end());
+	auto vert = vertices.add();
+	vert->point = p;
 
 	auto a = edges.makeEdge();
-	a.data() = EdgeData{{},{},Dest(e)};
-	a.Sym().data() = EdgeData{{},{},vert};
+	Org(a) = Dest(e);
+	Dest(a) = vert;
 	vert->leaves = a.Sym();
+	locator.add(vert);
 
 	splice(e.Lnext(), a);
 
@@ -135,8 +138,8 @@ EdgeRef Subdivision::add_vertex(EdgeRef e, Point p)
 EdgeRef Subdivision::connect(EdgeRef a, EdgeRef b)
 {
 	auto e = edges.makeEdge();
-	e.data() = EdgeData{{},{}, Dest(a)};
-	e.Sym().data() = EdgeData{{},{},Org(b)};
+	Org(e) = Dest(a);
+	Dest(e) = Org(b);
 
 	splice(e, a.Lnext());
 	splice(e.Sym(), b);
@@ -155,26 +158,29 @@ EdgeRef Subdivision::connect(EdgeRef a, EdgeRef b)
 
 EdgeRef Subdivision::splitVertex(EdgeRef a, EdgeRef b, Point const& p)
 {
-	vertices.push_back(Vertex{p});
-	VertexRef vnew = std::prev(vertices.end());
+	VertexRef vnew = vertices.add();
+	vnew->point = p;
 
-	EdgeRef e = edges.makeEdge().Rot();
+	EdgeRef e = edges.makeLoop();
 
 	splice(a, e);
 	splice(b, e.Sym());
 
-	e.data().var = Org(b);
-	e.InvRot().data().var = Left(a);
-	e.Rot().data().var = Left(b);
+	Org(e) = Org(b);
+	Left(e) = Left(a);
+	Right(e) = Left(b);
 	Org(b)->leaves = e;
 
 	auto eiter = e.Sym();
 	auto end{eiter};
 	do {
-		eiter.data().var = vnew;
+		Org(eiter) = vnew;
 		eiter = eiter.Onext();
 	} while (eiter != end);
 	vnew->leaves = e.Sym();
+	locator.add(vnew);
+	touch(Left(a));
+	touch(Left(b));
 
 	return e;
 }
@@ -196,14 +202,17 @@ void Subdivision::joinVertex(EdgeRef e)
 	auto eiter = a;
 	auto end = eiter;
 	do {
-		eiter.data().var = org_b;
+		Org(eiter) = org_b;
 		eiter = eiter.Onext();
 	} while (eiter != end);
 
 	Org(b)->leaves = b;
 	Left(b)->bounds = b;
 	Left(a)->bounds = a;
+	touch(Left(a));
+	touch(Left(b));
 
+	locator.remove(todelete);
 	vertices.erase(todelete);
 	edges.deleteEdge(e);
 }
@@ -215,27 +224,28 @@ EdgeRef Subdivision::splitFace(EdgeRef a, EdgeRef b)
 	FaceRef face = Left(a);
 	VertexRef org = Org(a), dest = Org(b);
 
-	faces.push_back(Face{});
-	FaceRef fnew = std::prev(faces.end());
+	FaceRef fnew = faces.add();
 
 	EdgeRef e = edges.makeEdge();
 
 	splice(e, a);
 	splice(e.Sym(), b);
 
-	e.data().var = org;
-	e.Sym().data().var = dest;
-	e.InvRot().data().var = face;
+	Org(e) = org;
+	Dest(e) = dest;
+	Left(e) = face;
 	face->bounds = e;
 
-	auto eiter = e.Rot();
+	auto eiter = e.Sym();
 	auto end = eiter;
 
 	do {
-		eiter.data().var = fnew;
-		eiter = eiter.Onext();
+		Left(eiter) = fnew;
+		eiter = eiter.Lnext();
 	} while (eiter != end);
 	fnew->bounds = e.Sym();
+	touch(face);
+	touch(fnew);
 
 	return e;
 }
@@ -251,17 +261,290 @@ void Subdivision::joinFace(EdgeRef e)
 	splice(a, e);
 	FaceRef left_b = Left(b);
 
-	auto eiter = a.InvRot();
+	auto eiter = a;
 	auto end = eiter;
 	do {
-		eiter.data().var = left_b;
-		eiter = eiter.Onext();
+		Left(eiter) = left_b;
+		eiter = eiter.Lnext();
 	} while (eiter != end);
 
 	Org(a)->leaves = a;
 	Org(b)->leaves = b;
 	Left(b)->bounds = b;
+	touch(left_b);
 
+	// outdate whatever was kept about the deleted face
+	++Right(e)->stamp;
 	faces.erase(Right(e));
 	edges.deleteEdge(e);
+}
+
+void Subdivision::touch(FaceRef f)
+{
+	++f->stamp;
+	if (changes)
+		changes->emplace_back(f, f->stamp);
+}
+
+#ifndef NO_FACE_GEOMETRY_CACHE
+TriangleGeometry const& Subdivision::geometry(FaceRef f)
+{
+	if (f->geometry_stamp != f->stamp) {
+		EdgeRef e = f->bounds;
+		f->geometry = triangleGeometry(Org(e)->point, Dest(e)->point, Dest(e.Onext())->point);
+		f->geometry_stamp = f->stamp;
+	}
+	return f->geometry;
+}
+#else
+TriangleGeometry Subdivision::geometry(FaceRef f)
+{
+	EdgeRef e = f->bounds;
+	return triangleGeometry(Org(e)->point, Dest(e)->point, Dest(e.Onext())->point);
+}
+#endif
+
+EdgeRef Subdivision::walkStart(Point p)
+{
+	// about 4 vertices a cell after a build; rebuild once they are 16
+	if (!locator.built() || vertices.size() > 16 * locator.samples.size())
+		locator.build(vertices);
+
+	VertexRef v = locator.nearest(p);
+	if (v == vertices.end())
+		return EdgeRef(edges.begin());
+	return v->leaves;
+}
+
+// Locator
+
+void Subdivision::Locator::build(Vertices const& vertices)
+{
+	*this = Locator{};
+	if (vertices.size() == 0)
+		return;
+
+	Point lo = vertices.begin()->point, hi = lo;
+	for (auto v = vertices.begin(); v != vertices.end(); ++v) {
+		Point const& p = v->point;
+		lo.x = std::min(lo.x, p.x); lo.y = std::min(lo.y, p.y);
+		hi.x = std::max(hi.x, p.x); hi.y = std::max(hi.y, p.y);
+	}
+
+	// square cells, about 4 vertices each
+	double w = hi.x - lo.x, h = hi.y - lo.y;
+	double cells = std::max(1.0, vertices.size() / 4.0);
+	cell = std::sqrt(w * h / cells);
+	if (!(cell > 0))
+		cell = std::max(w, h) / cells;
+	if (!(cell > 0))
+		cell = 1;
+	origin = lo;
+	nx = std::min(int(w / cell) + 1, 1 << 15);
+	ny = std::min(int(h / cell) + 1, 1 << 15);
+	samples.assign(std::size_t(nx) * ny, VertexRef{});
+
+	for (auto v = vertices.begin(); v != vertices.end(); ++v)
+		add(v);
+}
+
+std::size_t Subdivision::Locator::at(Point p) const
+{
+	// points off the grid fall into the border cells
+	int i = int(std::max(0.0, std::min((p.x - origin.x) / cell, nx - 1.0)));
+	int j = int(std::max(0.0, std::min((p.y - origin.y) / cell, ny - 1.0)));
+	return std::size_t(j) * nx + i;
+}
+
+void Subdivision::Locator::add(VertexRef v)
+{
+	if (built())
+		samples[at(v->point)] = v;
+}
+
+void Subdivision::Locator::remove(VertexRef v)
+{
+	if (!built())
+		return;
+	auto i = at(v->point);
+	if (samples[i] == v)
+		samples[i] = VertexRef{};
+}
+
+VertexRef Subdivision::Locator::nearest(Point p) const
+{
+	if (!built())
+		return VertexRef{};
+
+	// the closest sample in growing rings of cells around p
+	std::size_t c = at(p);
+	int ci = int(c % nx), cj = int(c / nx);
+	for (int r = 0; r < std::max(nx, ny); ++r) {
+		VertexRef best;
+		double best_d = 0;
+		auto visit = [&](int i, int j) {
+			VertexRef v = samples[std::size_t(j) * nx + i];
+			if (v == VertexRef{})
+				return;
+			double d = sqNorm(v->point - p);
+			if (best == VertexRef{} || d < best_d) {
+				best = v;
+				best_d = d;
+			}
+		};
+		for (int j = std::max(cj - r, 0); j <= std::min(cj + r, ny - 1); ++j) {
+			if (j == cj - r || j == cj + r) {
+				for (int i = std::max(ci - r, 0); i <= std::min(ci + r, nx - 1); ++i)
+					visit(i, j);
+				continue;
+			}
+			// only the ring's two side columns, where they are in the grid
+			if (ci - r >= 0)
+				visit(ci - r, j);
+			if (ci + r < nx)
+				visit(ci + r, j);
+		}
+		if (best != VertexRef{})
+			return best;
+	}
+	return VertexRef{};
+}
+
+EdgeRef Subdivision::encroachedSegment(Point p)
+{
+	// about one segment a cell after a build; rebuild once they are 4
+	if (!segments.built() || segments.count > 4 * segments.cells.size())
+		segments.build(edges);
+	return segments.encroached(p);
+}
+
+// Segments
+
+void Subdivision::Segments::build(Edges& edges)
+{
+	*this = Segments{};
+
+	bool any = false;
+	Point lo{}, hi{};
+	for (auto qref = edges.begin(); qref != edges.end(); ++qref) {
+		EdgeRef e(qref);
+		if (!e.data().fixed) continue;
+		for (Point const& p : {Org(e)->point, Dest(e)->point}) {
+			if (!any)
+				lo = hi = p;
+			lo.x = std::min(lo.x, p.x); lo.y = std::min(lo.y, p.y);
+			hi.x = std::max(hi.x, p.x); hi.y = std::max(hi.y, p.y);
+			any = true;
+		}
+		++count;
+	}
+
+	// square cells, about one segment each; an empty grid has a cell
+	double w = hi.x - lo.x, h = hi.y - lo.y;
+	double n = std::max(1.0, double(count));
+	cell = std::sqrt(w * h / n);
+	if (!(cell > 0))
+		cell = std::max(w, h) / n;
+	if (!(cell > 0))
+		cell = 1;
+	origin = lo;
+	nx = std::min(int(w / cell) + 1, 1 << 12);
+	ny = std::min(int(h / cell) + 1, 1 << 12);
+	cells.assign(std::size_t(nx) * ny, {});
+
+	count = 0;
+	for (auto qref = edges.begin(); qref != edges.end(); ++qref) {
+		EdgeRef e(qref);
+		if (e.data().fixed)
+			add(e);
+	}
+}
+
+// points off the grid fall into the border cells
+int Subdivision::Segments::col(double x) const
+{
+	return int(std::max(0.0, std::min((x - origin.x) / cell, nx - 1.0)));
+}
+
+int Subdivision::Segments::row(double y) const
+{
+	return int(std::max(0.0, std::min((y - origin.y) / cell, ny - 1.0)));
+}
+
+// the cells overlapped by the bounding box of e's diametral circle,
+// widened a little against rounding
+void Subdivision::Segments::span(EdgeRef e, int& i0, int& i1, int& j0, int& j1) const
+{
+	Point a = Org(e)->point, b = Dest(e)->point;
+	Point c = (a + b) * 0.5;
+	double r = dist(a, b) / 2.0 * (1 + 1e-9);
+	i0 = col(c.x - r); i1 = col(c.x + r);
+	j0 = row(c.y - r); j1 = row(c.y + r);
+}
+
+void Subdivision::Segments::add(EdgeRef e)
+{
+	add(e, next++);
+}
+
+void Subdivision::Segments::add(EdgeRef e, std::uint64_t serial)
+{
+	if (!built())
+		return;
+	// the edges list visits the even record of each edge
+	if (e.Sym() < e)
+		e = e.Sym();
+
+	int i0, i1, j0, j1;
+	span(e, i0, i1, j0, j1);
+	for (int j = j0; j <= j1; ++j)
+		for (int i = i0; i <= i1; ++i)
+			cells[std::size_t(j) * nx + i].push_back({e, serial});
+	++count;
+}
+
+std::uint64_t Subdivision::Segments::remove(EdgeRef e)
+{
+	if (!built())
+		return 0;
+	if (e.Sym() < e)
+		e = e.Sym();
+
+	std::uint64_t serial = next;
+	bool found = false;
+	int i0, i1, j0, j1;
+	span(e, i0, i1, j0, j1);
+	for (int j = j0; j <= j1; ++j)
+		for (int i = i0; i <= i1; ++i) {
+			auto& in = cells[std::size_t(j) * nx + i];
+			for (auto it = in.begin(); it != in.end(); ++it)
+				if (it->e == e) {
+					serial = it->serial;
+					in.erase(it);
+					found = true;
+					break;
+				}
+		}
+	if (found)
+		--count;
+	return serial;
+}
+
+EdgeRef Subdivision::Segments::encroached(Point p) const
+{
+	EdgeRef first;
+	std::uint64_t first_serial{};
+	for (Entry const& x : cells[std::size_t(row(p.y)) * nx + col(p.x)]) {
+		if (first && x.serial > first_serial)
+			continue;
+		// as encroaches(e, p) in mesh.cpp
+		Point a = Org(x.e)->point, b = Dest(x.e)->point;
+		double halflen = dist(a, b) / 2.0;
+		Point c = (a + b)*0.5;
+		if (dist(c, p) <= halflen) {
+			first = x.e;
+			first_serial = x.serial;
+		}
+	}
+	return first;
 }
\ No newline at end of file
@@ -1,38 +1,167 @@
 #pragma once
 #include "Point.h"
-#include "boost/variant.hpp"
-#include <list>
+#include "geom.h"
 #include <vector>
+#include <cassert>
+#include <atomic>
+#include <utility>
+#include "Arena.h"
 #include "QuadEdge.h"
 
 struct Subdivision 
 {
 	struct Vertex;
 	struct Face;
+	struct VertexBlock;
+	struct FaceBlock;
+	using VertexRef = ArenaRef<VertexBlock, Vertex>;
+	using FaceRef = ArenaRef<FaceBlock, Face>;
+
+	// The rotation of a record tells what its slot holds: even (primal)
+	// records keep their origin vertex, odd (dual) ones their origin face.
+	// Org/Dest/Left/Right assert the parity in debug builds.
 	struct EdgeData {
-		bool fixed; 
-		bool boundary;
-		boost::variant<std::list<Vertex>::iterator, std::list<Face>::iterator> var;
+		bool fixed{}; 
+		bool boundary{};
+		union Slot {
+			VertexRef vertex;
+			FaceRef face;
+			Slot() : vertex{} {}
+		} slot;
 	};
 
 	using Edges = QuadEdgeList<EdgeData>;
+
+	// Vertices and faces are stored as parallel arrays (see the blocks
+	// below); Vertex and Face are views of one element through references.
 	struct Vertex {
-		Point point;
-		Edges::EdgeRef leaves;
-		bool circumcenter;
+		Point& point;
+		Edges::EdgeRef& leaves;
+		bool& circumcenter;
+		std::uint64_t& serial;
+		Vertex* operator->() { return this; }
 	};
 	struct Face {
-		int mark{-1};
-		Edges::EdgeRef bounds;
+		int& mark;
+		Edges::EdgeRef& bounds;
+		std::uint32_t& stamp;
+		std::uint64_t& serial;
+#ifndef NO_FACE_GEOMETRY_CACHE
+		TriangleGeometry& geometry;
+		std::uint32_t& geometry_stamp;
+#endif
+		Face* operator->() { return this; }
+	};
+
+	// serial numbers vertices in order of creation, which is their order
+	// in a vertices list (merge renumbers the halves that
+	// delaunay_dnc_parallel builds on different threads to keep it so)
+	struct VertexBlock {
+		static constexpr unsigned shift = 12;
+		Point point[1 << shift];
+		Edges::EdgeRef leaves[1 << shift];
+		bool circumcenter[1 << shift];
+		std::uint64_t serial[1 << shift];
+		ArenaLink links[1 << shift];
+		static std::atomic<std::uint64_t> serials;
+
+		Vertex at(std::uint32_t i) { return Vertex{point[i], leaves[i], circumcenter[i], serial[i]}; }
+		void clear(std::uint32_t i) { point[i] = Point{}; leaves[i] = {}; circumcenter[i] = false; serial[i] = serials++; }
+	};
+	// stamp changes whenever the face does (see touch), so a copy of it
+	// tells whether cached facts about the face still hold; serial numbers
+	// faces in order of creation, which is their order in a faces list (as
+	// for vertices); geometry holds for the stamp in geometry_stamp (see
+	// Subdivision::geometry). The cache takes 52 of the 80 bytes of a face;
+	// builds with NO_FACE_GEOMETRY_CACHE defined leave it out.
+	struct FaceBlock {
+		static constexpr unsigned shift = 12;
+		int mark[1 << shift];
+		Edges::EdgeRef bounds[1 << shift];
+		std::uint32_t stamp[1 << shift];
+		std::uint64_t serial[1 << shift];
+#ifndef NO_FACE_GEOMETRY_CACHE
+		TriangleGeometry geometry[1 << shift];
+		std::uint32_t geometry_stamp[1 << shift];
+#endif
+		ArenaLink links[1 << shift];
+		static std::atomic<std::uint64_t> serials;
+
+#ifndef NO_FACE_GEOMETRY_CACHE
+		Face at(std::uint32_t i) {
+			return Face{mark[i], bounds[i], stamp[i], serial[i], geometry[i], geometry_stamp[i]};
+		}
+		void clear(std::uint32_t i) {
+			mark[i] = -1; bounds[i] = {}; ++stamp[i]; serial[i] = serials++;
+			geometry_stamp[i] = stamp[i] - 1;
+		}
+#else
+		Face at(std::uint32_t i) { return Face{mark[i], bounds[i], stamp[i], serial[i]}; }
+		void clear(std::uint32_t i) { mark[i] = -1; bounds[i] = {}; ++stamp[i]; serial[i] = serials++; }
+#endif
+	};
+
+	using Vertices = ArenaStore<VertexBlock, Vertex>;
+	using Faces = ArenaStore<FaceBlock, Face>;
+
+	// Grid of sampled vertices (the last one added to each cell) that gives
+	// point location walks a nearby start. Built on first use, rebuilt when
+	// the subdivision has grown well past the grid's resolution. A vertex
+	// has to be removed before its point changes and added back after.
+	struct Locator {
+		Point origin{};
+		double cell{};
+		int nx{}, ny{};
+		std::vector<VertexRef> samples;
+
+		bool built() const { return !samples.empty(); }
+		void build(Vertices const&);
+		void add(VertexRef);
+		void remove(VertexRef);
+		VertexRef nearest(Point) const;
+	private:
+		std::size_t at(Point) const;
 	};
-	using VertexRef = std::list<Subdivision::Vertex>::iterator;
-	using FaceRef = std::list<Subdivision::Face>::iterator;
 
+	// Grid of the fixed edges (segments), each listed in the cells its
+	// diametral circle overlaps, for encroachment queries. Built on first
+	// use and rebuilt as the segments multiply; a segment has to be removed
+	// before an endpoint changes and added back after, and one made fixed
+	// by other means than insertEdge (which adds its own) has to be added.
+	// Serials number the segments in the order they appear in the edges
+	// list, then the order they are added.
+	struct Segments {
+		struct Entry {
+			Edges::EdgeRef e;
+			std::uint64_t serial;
+		};
+		Point origin{};
+		double cell{};
+		int nx{}, ny{};
+		std::size_t count{};
+		std::uint64_t next{};
+		std::vector<std::vector<Entry>> cells;
+
+		bool built() const { return !cells.empty(); }
+		void build(Edges&);
+		void add(Edges::EdgeRef e);
+		void add(Edges::EdgeRef e, std::uint64_t serial);
+		std::uint64_t remove(Edges::EdgeRef e);
+		Edges::EdgeRef encroached(Point p) const;
+	private:
+		int col(double x) const;
+		int row(double y) const;
+		void span(Edges::EdgeRef e, int& i0, int& i1, int& j0, int& j1) const;
+	};
 
-	std::list<Face> faces;
-	std::list<Vertex> vertices;
+	Faces faces;
+	Vertices vertices;
 	Edges edges;
 	FaceRef outer_face;
+	Locator locator;
+	Segments segments;
+	// if set, touch() logs each face it stamps, with its new stamp
+	std::vector<std::pair<FaceRef, std::uint32_t>>* changes{};
 
 	Subdivision();
 	Subdivision(Point p1, Point p2);
@@ -46,16 +175,47 @@ struct Subdivision
 	Subdivision::Edges::EdgeRef
 		splitFace(Subdivision::Edges::EdgeRef a, Subdivision::Edges::EdgeRef b);
 	void joinFace(Subdivision::Edges::EdgeRef a);
+	// marks a face as changed; the four operations above touch the faces
+	// they change, code that moves a vertex has to touch its faces
+	void touch(FaceRef);
+	// circumcenter, squared circumradius and shortest edge, and area of a
+	// triangular face (taken from bounds), computed once per stamp of the face
+	// (on every call without the cache)
+#ifndef NO_FACE_GEOMETRY_CACHE
+	TriangleGeometry const& geometry(FaceRef);
+#else
+	TriangleGeometry geometry(FaceRef);
+#endif
+	// an edge near p to start a locate walk from
+	Subdivision::Edges::EdgeRef walkStart(Point p);
+	// the first fixed edge in the edges list that p encroaches upon
+	// (lies in the diametral circle of), or a null edge
+	Subdivision::Edges::EdgeRef encroachedSegment(Point p);
 };
 
 using EdgeRef = Subdivision::Edges::EdgeRef;
 using VertexRef = Subdivision::VertexRef;
 using FaceRef = Subdivision::FaceRef;
 
-Subdivision::VertexRef& Org(EdgeRef e);
-Subdivision::VertexRef& Dest(EdgeRef e);
-Subdivision::FaceRef& Left(EdgeRef e);
-Subdivision::FaceRef& Right(EdgeRef e);
+inline Subdivision::VertexRef& Org(EdgeRef e) {
+	assert(!e.dual());
+	return e.data().slot.vertex;
+}
+
+inline Subdivision::VertexRef& Dest(EdgeRef e) {
+	assert(!e.dual());
+	return e.Sym().data().slot.vertex;
+}
+
+inline Subdivision::FaceRef& Left(EdgeRef e) {
+	assert(!e.dual());
+	return e.InvRot().data().slot.face;
+}
+
+inline Subdivision::FaceRef& Right(EdgeRef e) {
+	assert(!e.dual());
+	return e.Rot().data().slot.face;
+}
 
 void printEdge(EdgeRef);
 std::ostream& operator<< (std::ostream& os, EdgeRef e);
\ No newline at end of file
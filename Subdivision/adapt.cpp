@@ -36,9 +36,9 @@
 /*  First, read the short or long version of the paper (from the Web page    */
 /*    above).                                                                */
 /*                                                                           */
-/*  Be sure to call exactinit() once, before calling any of the arithmetic   */
-/*    functions or geometric predicates.  Also be sure to turn on the        */
-/*    optimizer when compiling this file.                                    */
+/*  The constants exactinit() computed are fixed at compile time (adapt.h), */
+/*    so exactinit() does nothing and need not be called.  Be sure to turn   */
+/*    on the optimizer when compiling this file.                             */
 /*                                                                           */
 /*                                                                           */
 /*  Several geometric predicates are defined.  Their parameters are all      */
@@ -116,6 +116,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include "adapt.h"
 //#include <sys/time.h>
 
 /* On some machines, the exact arithmetic routines might be defeated by the  */
@@ -358,14 +359,9 @@
   Square(a1, _j, _1); \
   Two_Two_Sum(_j, _1, _l, _2, x5, x4, x3, x2)
 
-REAL splitter;     /* = 2^ceiling(p / 2) + 1.  Used to split floats in half. */
-REAL epsilon;                /* = 2^(-p).  Used to estimate roundoff errors. */
-							 /* A set of coefficients used to calculate maximum roundoff errors.          */
-REAL resulterrbound;
-REAL ccwerrboundA, ccwerrboundB, ccwerrboundC;
-REAL o3derrboundA, o3derrboundB, o3derrboundC;
-REAL iccerrboundA, iccerrboundB, iccerrboundC;
-REAL isperrboundA, isperrboundB, isperrboundC;
+/* splitter, epsilon and the error bounds are compile-time constants in     */
+/*   adapt.h.                                                                */
+using namespace robust;
 
 /*****************************************************************************/
 /*                                                                           */
@@ -623,63 +619,18 @@ float uniformfloatrand()
 
 /*****************************************************************************/
 /*                                                                           */
-/*  exactinit()   Initialize the variables used for exact arithmetic.        */
+/*  exactinit()   Kept for old callers; does nothing.                        */
 /*                                                                           */
-/*  `epsilon' is the largest power of two such that 1.0 + epsilon = 1.0 in   */
-/*  floating-point arithmetic.  `epsilon' bounds the relative roundoff       */
-/*  error.  It is used for floating-point error analysis.                    */
-/*                                                                           */
-/*  `splitter' is used to split floating-point numbers into two half-        */
-/*  length significands for exact multiplication.                            */
-/*                                                                           */
-/*  I imagine that a highly optimizing compiler might be too smart for its   */
-/*  own good, and somehow cause this routine to fail, if it pretends that    */
-/*  floating-point arithmetic is too much like real arithmetic.              */
-/*                                                                           */
-/*  Don't change this routine unless you fully understand it.                */
+/*  It used to measure `epsilon' (the largest power of two such that         */
+/*  1.0 + epsilon = 1.0) and `splitter' (used to split floating-point        */
+/*  numbers into two half-length significands) and derive the error bounds   */
+/*  from them.  For IEEE-754 doubles they are the constants in adapt.h.      */
 /*                                                                           */
 /*****************************************************************************/
 
 void exactinit()
 {
-	REAL half;
-	REAL check, lastcheck;
-	int every_other;
-
-	every_other = 1;
-	half = 0.5;
-	epsilon = 1.0;
-	splitter = 1.0;
-	check = 1.0;
-	/* Repeatedly divide `epsilon' by two until it is too small to add to    */
-	/*   one without causing roundoff.  (Also check if the sum is equal to   */
-	/*   the previous sum, for machines that round up instead of using exact */
-	/*   rounding.  Not that this library will work on such machines anyway. */
-	do {
-		lastcheck = check;
-		epsilon *= half;
-		if (every_other) {
-			splitter *= 2.0;
-		}
-		every_other = !every_other;
-		check = 1.0 + epsilon;
-	} while ((check != 1.0) && (check != lastcheck));
-	splitter += 1.0;
-
-	/* Error bounds for orientation and incircle tests. */
-	resulterrbound = (3.0 + 8.0 * epsilon) * epsilon;
-	ccwerrboundA = (3.0 + 16.0 * epsilon) * epsilon;
-	ccwerrboundB = (2.0 + 12.0 * epsilon) * epsilon;
-	ccwerrboundC = (9.0 + 64.0 * epsilon) * epsilon * epsilon;
-	o3derrboundA = (7.0 + 56.0 * epsilon) * epsilon;
-	o3derrboundB = (3.0 + 28.0 * epsilon) * epsilon;
-	o3derrboundC = (26.0 + 288.0 * epsilon) * epsilon * epsilon;
-	iccerrboundA = (10.0 + 96.0 * epsilon) * epsilon;
-	iccerrboundB = (4.0 + 48.0 * epsilon) * epsilon;
-	iccerrboundC = (44.0 + 576.0 * epsilon) * epsilon * epsilon;
-	isperrboundA = (16.0 + 224.0 * epsilon) * epsilon;
-	isperrboundB = (5.0 + 72.0 * epsilon) * epsilon;
-	isperrboundC = (71.0 + 1408.0 * epsilon) * epsilon * epsilon;
+	/* nothing left to do, see adapt.h */
 }
 
 /*****************************************************************************/
@@ -1520,6 +1471,7 @@ REAL orient2dadapt(REAL* pa, REAL* pb, REAL* pc, REAL detsum)
 	det = estimate(4, B);
 	errbound = ccwerrboundB * detsum;
 	if ((det >= errbound) || (-det >= errbound)) {
+		COUNT_STAGE(orient2dStages, stage_b, 1);
 		return det;
 	}
 
@@ -1530,6 +1482,7 @@ REAL orient2dadapt(REAL* pa, REAL* pb, REAL* pc, REAL detsum)
 
 	if ((acxtail == 0.0) && (acytail == 0.0)
 		&& (bcxtail == 0.0) && (bcytail == 0.0)) {
+		COUNT_STAGE(orient2dStages, stage_b, 1);
 		return det;
 	}
 
@@ -1537,6 +1490,7 @@ REAL orient2dadapt(REAL* pa, REAL* pb, REAL* pc, REAL detsum)
 	det += (acx * bcytail + bcy * acxtail)
 		- (acy * bcxtail + bcx * acytail);
 	if ((det >= errbound) || (-det >= errbound)) {
+		COUNT_STAGE(orient2dStages, stage_c, 1);
 		return det;
 	}
 
@@ -1558,6 +1512,7 @@ REAL orient2dadapt(REAL* pa, REAL* pb, REAL* pc, REAL detsum)
 	u[3] = u3;
 	Dlength = fast_expansion_sum_zeroelim(C2length, C2, 4, u, D);
 
+	COUNT_STAGE(orient2dStages, stage_exact, 1);
 	return(D[Dlength - 1]);
 }
 
@@ -1572,6 +1527,7 @@ REAL orient2d(REAL* pa, REAL* pb, REAL* pc)
 
 	if (detleft > 0.0) {
 		if (detright <= 0.0) {
+			COUNT_STAGE(orient2dStages, stage_fast, 1);
 			return det;
 		}
 		else {
@@ -1580,6 +1536,7 @@ REAL orient2d(REAL* pa, REAL* pb, REAL* pc)
 	}
 	else if (detleft < 0.0) {
 		if (detright >= 0.0) {
+			COUNT_STAGE(orient2dStages, stage_fast, 1);
 			return det;
 		}
 		else {
@@ -1587,11 +1544,13 @@ REAL orient2d(REAL* pa, REAL* pb, REAL* pc)
 		}
 	}
 	else {
+		COUNT_STAGE(orient2dStages, stage_fast, 1);
 		return det;
 	}
 
 	errbound = ccwerrboundA * detsum;
 	if ((det >= errbound) || (-det >= errbound)) {
+		COUNT_STAGE(orient2dStages, stage_fast, 1);
 		return det;
 	}
 
@@ -2676,6 +2635,7 @@ REAL incircleadapt(REAL* pa, REAL* pb, REAL* pc, REAL* pd, REAL permanent)
 	det = estimate(finlength, fin1);
 	errbound = iccerrboundB * permanent;
 	if ((det >= errbound) || (-det >= errbound)) {
+		COUNT_STAGE(incircleStages, stage_b, 1);
 		return det;
 	}
 
@@ -2687,6 +2647,7 @@ REAL incircleadapt(REAL* pa, REAL* pb, REAL* pc, REAL* pd, REAL permanent)
 	Two_Diff_Tail(pc[1], pd[1], cdy, cdytail);
 	if ((adxtail == 0.0) && (bdxtail == 0.0) && (cdxtail == 0.0)
 		&& (adytail == 0.0) && (bdytail == 0.0) && (cdytail == 0.0)) {
+		COUNT_STAGE(incircleStages, stage_b, 1);
 		return det;
 	}
 
@@ -2701,6 +2662,7 @@ REAL incircleadapt(REAL* pa, REAL* pb, REAL* pc, REAL* pd, REAL permanent)
 			- (ady * bdxtail + bdx * adytail))
 			+ 2.0 * (cdx * cdxtail + cdy * cdytail) * (adx * bdy - ady * bdx));
 	if ((det >= errbound) || (-det >= errbound)) {
+		COUNT_STAGE(incircleStages, stage_c, 1);
 		return det;
 	}
 
@@ -3139,6 +3101,7 @@ REAL incircleadapt(REAL* pa, REAL* pb, REAL* pc, REAL* pd, REAL permanent)
 		}
 	}
 
+	COUNT_STAGE(incircleStages, stage_exact, 1);
 	return finnow[finlength - 1];
 }
 
@@ -3178,6 +3141,7 @@ REAL incircle(REAL* pa, REAL* pb, REAL* pc, REAL* pd)
 		+ (Absolute(adxbdy) + Absolute(bdxady)) * clift;
 	errbound = iccerrboundA * permanent;
 	if ((det > errbound) || (-det > errbound)) {
+		COUNT_STAGE(incircleStages, stage_fast, 1);
 		return det;
 	}
 
@@ -0,0 +1,49 @@
+#pragma once
+#include <limits>
+
+// Constants of the robust predicates in adapt.cpp, fixed at compile time
+// for IEEE-754 doubles rounding to nearest; exactinit() used to measure
+// them at run time.
+static_assert(std::numeric_limits<double>::is_iec559 && std::numeric_limits<double>::digits == 53,
+	"adapt.cpp needs IEEE-754 doubles");
+
+namespace robust {
+
+// 2^-53, the largest power of two such that 1.0 + epsilon == 1.0
+constexpr double epsilon = 1.0 / 9007199254740992.0;
+// 2^27 + 1, splits a double into two half-length significands
+constexpr double splitter = 134217728.0 + 1.0;
+
+constexpr double resulterrbound = (3.0 + 8.0 * epsilon) * epsilon;
+constexpr double ccwerrboundA = (3.0 + 16.0 * epsilon) * epsilon;
+constexpr double ccwerrboundB = (2.0 + 12.0 * epsilon) * epsilon;
+constexpr double ccwerrboundC = (9.0 + 64.0 * epsilon) * epsilon * epsilon;
+constexpr double o3derrboundA = (7.0 + 56.0 * epsilon) * epsilon;
+constexpr double o3derrboundB = (3.0 + 28.0 * epsilon) * epsilon;
+constexpr double o3derrboundC = (26.0 + 288.0 * epsilon) * epsilon * epsilon;
+constexpr double iccerrboundA = (10.0 + 96.0 * epsilon) * epsilon;
+constexpr double iccerrboundB = (4.0 + 48.0 * epsilon) * epsilon;
+constexpr double iccerrboundC = (44.0 + 576.0 * epsilon) * epsilon * epsilon;
+constexpr double isperrboundA = (16.0 + 224.0 * epsilon) * epsilon;
+constexpr double isperrboundB = (5.0 + 72.0 * epsilon) * epsilon;
+constexpr double isperrboundC = (71.0 + 1408.0 * epsilon) * epsilon * epsilon;
+
+}
+
+// Which stage settled each orient2d and incircle call, counted per thread
+// in builds with PREDICATE_STATS (predicates.h sums them over the threads);
+// in other builds COUNT_STAGE expands to nothing.
+enum PredicateStage { stage_fast, stage_b, stage_c, stage_exact, stage_count };
+#ifdef PREDICATE_STATS
+// a thread's counts, listed with predicates.cpp while the thread lives
+struct PredicateCounts {
+	unsigned long long orient2dStages[stage_count];
+	unsigned long long incircleStages[stage_count];
+	PredicateCounts();
+	~PredicateCounts();
+};
+extern thread_local PredicateCounts predicateCounts;
+#define COUNT_STAGE(counts, stage, k) (predicateCounts.counts[stage] += (k))
+#else
+#define COUNT_STAGE(counts, stage, k) ((void)0)
+#endif
\ No newline at end of file
@@ -0,0 +1,298 @@
+#include "bench.h"
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include <random>
+#include <fstream>
+#include <cstdio>
+#include <cmath>
+#include <limits>
+#include <iterator>
+#include <string>
+#include "Point.h"
+#include "geom.h"
+#include "delaunay.h"
+#include "input.h"
+#include "predicates.h"
+#include "mesh.h"
+#include "meshfile.h"
+#include "checkpoint.h"
+
+template <class Fun>
+static double seconds(Fun f)
+{
+	auto start = std::chrono::steady_clock::now();
+	f();
+	std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+	return d.count();
+}
+
+static std::vector<Point> distinct(std::vector<Point> pts)
+{
+	std::sort(pts.begin(), pts.end());
+	pts.erase(std::unique(pts.begin(), pts.end()), pts.end());
+	return pts;
+}
+
+// delaunay_dnc (including the presort it needs) against delaunay_dwyer
+void bench_dnc()
+{
+	std::vector<Rect> rects{{{0,0},{1,1}}, {{0,0},{1000,1}}, {{0,0},{1,1000}}};
+	for (Rect r : rects)
+		for (int n : {10000, 100000, 1000000})
+		{
+			auto pts = distinct(rectUniform(r, n));
+			std::shuffle(pts.begin(), pts.end(), std::mt19937{});
+
+			std::vector<Point> input = pts;
+			double t_dnc = seconds([&] {
+				std::sort(input.begin(), input.end());
+				auto res = delaunay_dnc(input.begin(), input.end());
+			});
+
+			input = pts;
+			double t_dwyer = seconds([&] {
+				auto res = delaunay_dwyer(input.begin(), input.end());
+			});
+
+			std::cout << "rectUniform " << r.dir.x << 'x' << r.dir.y << ' ' << pts.size()
+				<< "\tdnc: " << t_dnc << " s\tdwyer: " << t_dwyer << " s\n";
+		}
+}
+
+// a triangulation of a triangle around the sites, to insert them into
+static Subdivision cover(std::vector<Point>& pts)
+{
+	auto trian = triangleCover(pts);
+	std::vector<Point> corners(trian.begin(), trian.end());
+	std::sort(corners.begin(), corners.end());
+	return std::get<0>(delaunay_dnc(corners.begin(), corners.end()));
+}
+
+// incremental insertion in the given (random) order against insertSiteBatch
+void bench_insertion()
+{
+	for (int n : {10000, 100000, 1000000})
+	{
+		auto pts = rectUniform({{0,0},{1,1}}, n);
+
+		// random order walks O(sqrt n) steps per site; minutes for 1e6 sites
+		bool sequential = n <= 100000;
+		WalkStats walk;
+		Subdivision s = cover(pts);
+		double t_seq = sequential ? seconds([&] {
+			EdgeRef close(s.edges.begin());
+			for (Point const& p : pts) {
+				VertexRef v = insertSite(s, p, close, &walk);
+				if (v != s.vertices.end())
+					close = v->leaves;
+			}
+		}) : 0;
+
+		WalkStats brio;
+		Subdivision b = cover(pts);
+		double t_brio = seconds([&] {
+			brio = insertSiteBatch(b, pts);
+		});
+
+		std::cout << "insert " << n;
+		if (sequential)
+			std::cout << "\tsequence: " << t_seq << " s, walk " << walk.mean() << " avg " << walk.max_steps << " max";
+		else
+			std::cout << "\tsequence: skipped";
+		std::cout << "\tbatch: " << t_brio << " s, walk " << brio.mean() << " avg " << brio.max_steps << " max\n";
+	}
+}
+
+// read_points against reading the same file with an ifstream
+void bench_input()
+{
+	char const* path = "bench_points.txt";
+	for (int n : {100000, 1000000, 10000000})
+	{
+		{
+			std::ofstream out(path);
+			out.precision(17);
+			for (Point const& p : rectUniform({{0,0},{1000,1000}}, n))
+				out << p.x << ' ' << p.y << '\n';
+		}
+
+		std::vector<Point> pts;
+		double t_read = seconds([&] {
+			read_points(path, pts);
+		});
+
+		std::vector<Point> ref;
+		double t_stream = seconds([&] {
+			std::ifstream in(path);
+			Point p;
+			while (in >> p.x >> p.y)
+				ref.push_back(p);
+		});
+
+		std::cout << "read " << n << "\tread_points: " << t_read << " s\tifstream: " << t_stream << " s"
+			<< (pts.size() == ref.size() && std::equal(pts.begin(), pts.end(), ref.begin()) ? "" : "\tMISMATCH") << '\n';
+	}
+	std::remove(path);
+}
+
+// the vertex nearest to p
+static VertexRef nearest(Subdivision& s, Point p)
+{
+	VertexRef best = s.vertices.begin();
+	double best_d = std::numeric_limits<double>::max();
+	for (auto v = s.vertices.begin(); v != s.vertices.end(); ++v) {
+		double dx = v->point.x - p.x, dy = v->point.y - p.y;
+		if (dx*dx + dy*dy < best_d) {
+			best_d = dx*dx + dy*dy;
+			best = v;
+		}
+	}
+	return best;
+}
+
+// edges crossing segment ab
+static std::size_t crossings(Subdivision& s, VertexRef a, VertexRef b)
+{
+	std::size_t n = 0;
+	for (auto q = s.edges.begin(); q != s.edges.end(); ++q) {
+		EdgeRef e(q, 0);
+		Point const& p = Org(e)->point;
+		Point const& r = Dest(e)->point;
+		if (orient2d(a->point, b->point, p) * orient2d(a->point, b->point, r) < 0
+			&& orient2d(p, r, a->point) * orient2d(p, r, b->point) < 0)
+			++n;
+	}
+	return n;
+}
+
+// n points on two circular arcs, above and below, meeting at (-1,0) and
+// (1,0): a thin lens for c much more than 1, whose chord crosses nearly
+// every edge and leaves a cavity of nearly cocircular vertices
+static std::vector<Point> lens(int n, double c)
+{
+	double r = std::sqrt(1 + c*c);
+	double t0 = std::atan2(c, 1.0);
+	int m = n / 2;
+	double step = (std::atan2(c, -1.0) - t0) / m;
+	std::vector<Point> pts;
+	for (int i = 0; i <= m; ++i)
+		pts.push_back({r*std::cos(t0 + step*i), r*std::sin(t0 + step*i) - c});
+	for (int i = 0; i < m; ++i)
+		pts.push_back({r*std::cos(t0 + step*(i + 0.5)), c - r*std::sin(t0 + step*(i + 0.5))});
+	return pts;
+}
+
+// insertEdge of a segment across the whole domain, which leaves a cavity
+// of every edge it crosses for triangulatePseudoPolygon
+void bench_segments()
+{
+	struct Case {
+		char const* name;
+		std::vector<Point> pts;
+		Point from, to;
+	};
+	std::vector<Case> cases;
+	for (int n : {100000, 1000000}) {
+		cases.push_back({"rectUniform 1x1", rectUniform({{0,0},{1,1}}, n), {0,0.5}, {1,0.5}});
+		cases.push_back({"rectUniform 1000x1", rectUniform({{0,0},{1000,1}}, n), {0,0.5}, {1000,0.5}});
+	}
+	for (int n : {10000, 100000})
+		cases.push_back({"lens", lens(n, 10), {-1,0}, {1,0}});
+
+	for (Case& c : cases)
+	{
+		Subdivision s = cover(c.pts);
+		insertSiteBatch(s, c.pts);
+		VertexRef a = nearest(s, c.from);
+		VertexRef b = nearest(s, c.to);
+		std::size_t crossed = crossings(s, a, b);
+
+		double t = seconds([&] {
+			insertEdge(s, a, b);
+		});
+
+		std::cout << "segment " << c.name << ' ' << c.pts.size()
+			<< "\tcrossing " << crossed << " edges: " << t << " s\n";
+	}
+}
+
+// the loops main refines when given no .poly file, some of them
+static Subdivision loops()
+{
+	auto model = rectHull({{-4,-4},{8,8}}, 1, 1);
+	auto trian = triangleCover(model);
+	std::vector<Point> corners(trian.begin(), trian.end());
+	std::sort(corners.begin(), corners.end());
+	Subdivision dt;
+	EdgeRef l, r;
+	std::tie(dt, l, r) = delaunay_dnc(corners.begin(), corners.end());
+	insertClosedLoop(dt, model);
+	insertClosedLoop(dt, circleHull({0,0}, 1.0, 20));
+	insertClosedLoop(dt, circleHull({3.5,3.5}, 0.25, 10));
+	init_faces(dt);
+	mark_outer_faces(dt, r);
+	return dt;
+}
+
+static std::string contents(char const* path)
+{
+	std::ifstream in(path, std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// a refiner run plainly, with checkpoints every 50 iterations and resumed
+// from one of them half way, each of which has to save the same mesh
+void bench_checkpoints()
+{
+	struct Case {
+		char const* name;
+		void (*refine)(Subdivision&, int iters, Checkpoints*);
+	};
+	Case cases[] = {
+		{"ruppert 1.0", [](Subdivision& dt, int iters, Checkpoints* c) { ruppert_refinement(dt, 1.0, iters, c); }},
+		{"alper 0.85", [](Subdivision& dt, int iters, Checkpoints* c) { chew_2nd_refinement_alper(dt, 0.85, iters, c); }},
+	};
+	char const* path = "bench_checkpoint.qem";
+	char const* out = "bench_mesh.qem";
+	int iters = 3000;
+
+	for (Case const& c : cases)
+	{
+		Subdivision plain = loops();
+		double t_plain = seconds([&] {
+			c.refine(plain, iters, nullptr);
+		});
+		save_mesh(out, plain);
+		std::string expected = contents(out);
+
+		Subdivision checked = loops();
+		Checkpoints every(path, 50);
+		double t_checked = seconds([&] {
+			c.refine(checked, iters, &every);
+		});
+		save_mesh(out, checked);
+		bool same = contents(out) == expected;
+
+		{
+			Subdivision half = loops();
+			Checkpoints first(path, 50);
+			c.refine(half, iters / 2, &first);
+		}
+		Subdivision resumed;
+		Checkpoints rest(path, 50);
+		if (rest.resume(resumed)) {
+			c.refine(resumed, iters, &rest);
+			save_mesh(out, resumed);
+			same = same && contents(out) == expected;
+		}
+		else
+			same = false;
+
+		std::cout << "checkpoints " << c.name << "\tplain: " << t_plain << " s\tevery 50: " << t_checked << " s"
+			<< (same ? "" : "\tMISMATCH") << '\n';
+	}
+	std::remove(path);
+	std::remove(out);
+}
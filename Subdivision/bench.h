@@ -0,0 +1,8 @@
+#pragma once
+
+// timing runs, started by passing "bench" to the program
+void bench_dnc();
+void bench_insertion();
+void bench_input();
+void bench_segments();
+void bench_checkpoints();
@@ -0,0 +1,53 @@
+#include "checkpoint.h"
+#include "meshfile.h"
+#include <cstdio>
+#include <iostream>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+// renames 'from' to 'to', replacing 'to' in one step
+static bool replace_file(std::string const& from, std::string const& to)
+{
+#ifdef _WIN32
+	return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+Checkpoints::Checkpoints(std::string path, int iters, double seconds)
+	: path(std::move(path)), iters{iters}, seconds{seconds},
+	last_time{std::chrono::steady_clock::now()}
+{
+}
+
+bool Checkpoints::resume(Subdivision& dt)
+{
+	std::uint64_t iterations;
+	if (!load_mesh(path.c_str(), dt, &iterations))
+		return false;
+	start = last_iteration = int(iterations);
+	last_time = std::chrono::steady_clock::now();
+	return true;
+}
+
+void Checkpoints::step(Subdivision& dt, int iterations)
+{
+	auto now = std::chrono::steady_clock::now();
+	bool due = (iters > 0 && iterations - last_iteration >= iters)
+		|| (seconds > 0 && std::chrono::duration<double>(now - last_time).count() >= seconds);
+	if (!due)
+		return;
+
+	std::string temp = path + ".tmp";
+	if (save_mesh(temp.c_str(), dt, std::uint64_t(iterations)) && !replace_file(temp, path))
+		std::cerr << path << ": cannot replace the checkpoint\n";
+
+	last_iteration = iterations;
+	last_time = std::chrono::steady_clock::now();
+}
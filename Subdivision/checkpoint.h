@@ -0,0 +1,40 @@
+#pragma once
+#include "Subdivision.h"
+#include <chrono>
+#include <string>
+
+// Snapshots of a refinement run for picking it up after it is stopped.
+// Given to a refiner (see mesh.h), they write the subdivision in the mesh
+// file format (meshfile.h) with the number of iterations done, every
+// 'iters' iterations or 'seconds' seconds, whichever comes first (0 turns
+// either off). A file is written next to 'path' and then renamed over it,
+// so a killed run leaves the last complete checkpoint behind.
+//
+// Writing checkpoints leaves a run as it is, and a run resumed from one
+// with the same refiner and parameters takes the same steps as the run
+// that wrote it. Besides the mesh, the refiners depend on the locator
+// grid, which is saved along (the walks it starts end at other edges of
+// the same face, and the new faces' geometry rounds differently); the
+// faces queue and the segment grid order by face serial and list order,
+// so starting them afresh in the resumed run changes nothing.
+class Checkpoints
+{
+public:
+	Checkpoints(std::string path, int iters, double seconds = 0);
+
+	// Loads the checkpoint at 'path' into dt (see load_mesh), after which
+	// a refiner given these checkpoints carries on where it was written.
+	bool resume(Subdivision& dt);
+	// iterations done before the refiner started
+	int done() const { return start; }
+
+	// after each iteration of a refiner: writes a checkpoint when one is due
+	void step(Subdivision& dt, int iterations);
+private:
+	std::string path;
+	int iters;
+	double seconds;
+	int start{};
+	int last_iteration{};
+	std::chrono::steady_clock::time_point last_time;
+};
@@ -1,5 +1,9 @@
 #include "delaunay.h"
 #include "predicates.h"
+#include "geom.h"
+#include <future>
+#include <algorithm>
+#include <random>
 
 
 void swap(EdgeRef e)
@@ -15,8 +19,8 @@ void swap(EdgeRef e)
 	splice(e, a); splice(e.Sym(), b);
 	splice(e, a.Lnext()); splice(e.Sym(), b.Lnext());
 	
-	e.data().var = a.Sym().data().var;
-	e.Sym().data().var = b.Sym().data().var;
+	Org(e) = Dest(a);
+	Dest(e) = Dest(b);
 }
 
 bool rightOf(Point p, EdgeRef e)
@@ -74,8 +78,9 @@ bool onEdge(Point c, EdgeRef e) {
 	return false;
 }
 
-std::tuple<Subdivision, EdgeRef, EdgeRef>
-delaunay_dnc(std::vector<Point>::iterator b, std::vector<Point>::iterator e)
+// 2 or 3 sites
+static std::tuple<Subdivision, EdgeRef, EdgeRef>
+dnc_base(std::vector<Point>::iterator b, std::vector<Point>::iterator e)
 {
 	if (std::distance(b, e) == 2) {
 		Subdivision s(*b, *(b + 1));
@@ -83,7 +88,7 @@ delaunay_dnc(std::vector<Point>::iterator b, std::vector<Point>::iterator e)
 
 		return std::make_tuple(std::move(s), e, e.Sym());
 	}
-	else if (std::distance(b, e) == 3) {
+	else {
 		auto s1 = b;
 		auto s2 = b + 1;
 		auto s3 = b + 2;
@@ -104,14 +109,12 @@ delaunay_dnc(std::vector<Point>::iterator b, std::vector<Point>::iterator e)
 		else
 			return std::make_tuple(std::move(s), e1, e2.Sym());
 	}
-	// else if S.size() >= 4 :
-
-	auto mid{b}; std::advance(mid, std::distance(b, e) / 2);
-	Subdivision L, R;
-	EdgeRef ldo, ldi, rdi, rdo;
-	std::tie(L, ldo, ldi) = delaunay_dnc(b, mid);
-	std::tie(R, rdi, rdo) = delaunay_dnc(mid, e);
+}
 
+// joins two triangulations separated by a vertical line, R to the right of L
+static std::tuple<Subdivision, EdgeRef, EdgeRef>
+dnc_merge(Subdivision& L, EdgeRef ldo, EdgeRef ldi, Subdivision& R, EdgeRef rdi, EdgeRef rdo)
+{
 	L.merge(R); // physical merge
 
 	// logical merge:
@@ -155,28 +158,122 @@ delaunay_dnc(std::vector<Point>::iterator b, std::vector<Point>::iterator e)
 	return std::make_tuple(std::move(L), ldo, rdo);
 }
 
-EdgeRef locate(Subdivision & s, Point x)
+std::tuple<Subdivision, EdgeRef, EdgeRef>
+delaunay_dnc(std::vector<Point>::iterator b, std::vector<Point>::iterator e)
 {
-	std::size_t N = s.edges.size(); // ?
-	EdgeRef e(s.edges.begin());
+	if (std::distance(b, e) <= 3)
+		return dnc_base(b, e);
+
+	auto mid{b}; std::advance(mid, std::distance(b, e) / 2);
+	Subdivision L, R;
+	EdgeRef ldo, ldi, rdi, rdo;
+	std::tie(L, ldo, ldi) = delaunay_dnc(b, mid);
+	std::tie(R, rdi, rdo) = delaunay_dnc(mid, e);
 
+	return dnc_merge(L, ldo, ldi, R, rdi, rdo);
+}
+
+// The left half is built by an asynchronous task while the calling thread
+// builds the right one; each side gets half of the thread budget. Both
+// halves allocate from their thread's own arena blocks, so the merge only
+// splices chains.
+std::tuple<Subdivision, EdgeRef, EdgeRef>
+delaunay_dnc_parallel(std::vector<Point>::iterator b, std::vector<Point>::iterator e,
+	unsigned threads, std::size_t cutoff)
+{
+	if (threads < 2 || std::size_t(std::distance(b, e)) < std::max<std::size_t>(cutoff, 4))
+		return delaunay_dnc(b, e);
+
+	auto mid{b}; std::advance(mid, std::distance(b, e) / 2);
+	auto left = std::async(std::launch::async, [=] {
+		return delaunay_dnc_parallel(b, mid, threads / 2, cutoff);
+	});
+	Subdivision L, R;
+	EdgeRef ldo, ldi, rdi, rdo;
+	std::tie(R, rdi, rdo) = delaunay_dnc_parallel(mid, e, threads - threads / 2, cutoff);
+	std::tie(L, ldo, ldi) = left.get();
+
+	return dnc_merge(L, ldo, ldi, R, rdi, rdo);
+}
+
+// Order of the sites along a cut axis: 0 - by x, then y; 1 - by y, then -x.
+// Axis 1 is axis 0 after turning the plane by -90 degrees, and since the
+// predicates don't change under rotation, dnc_base and dnc_merge work
+// along either axis.
+static bool precedes(Point const& p, Point const& q, int axis)
+{
+	if (axis == 0)
+		return p.x < q.x || (p.x == q.x && p.y < q.y);
+	return p.y < q.y || (p.y == q.y && p.x > q.x);
+}
+
+// Walks the convex hull starting from the ccw hull edge 'h' and returns
+// the ccw hull edge out of the first vertex along 'axis' and the cw hull
+// edge out of the last one.
+static std::pair<EdgeRef, EdgeRef> hull_extremes(EdgeRef h, int axis)
+{
+	EdgeRef lo = h, hi = h;
+	EdgeRef e = h;
 	do {
-		N--;
-		if (rightOf(x, e))
-			e = e.Sym();
-		else if (!rightOf(x, e.Onext()))
-			e = e.Onext();
-		else if (!rightOf(x, e.Dprev()))
-			e = e.Dprev();
-		else {
-			//std::cout << s.edges.size() - N << '\n';
-			return e;
-		}
-	} while (N);
-	return EdgeRef{};
+		if (precedes(Org(e)->point, Org(lo)->point, axis)) lo = e;
+		if (precedes(Dest(hi)->point, Dest(e)->point, axis)) hi = e;
+		e = e.Rprev();
+	} while (e != h);
+	return {lo, hi.Sym()};
+}
+
+// across the longer side of the bounding box
+static int cut_axis(std::vector<Point>::iterator b, std::vector<Point>::iterator e)
+{
+	Point lo = *b, hi = *b;
+	std::for_each(b, e, [&](Point const& p) {
+		lo.x = std::min(lo.x, p.x); hi.x = std::max(hi.x, p.x);
+		lo.y = std::min(lo.y, p.y); hi.y = std::max(hi.y, p.y);
+	});
+	return hi.x - lo.x >= hi.y - lo.y ? 0 : 1;
 }
 
-EdgeRef locate(Subdivision& s, Point x, EdgeRef e)
+// Each range is cut across the longer side of its bounding box, so on
+// roughly square sets of sites vertical and horizontal cuts alternate and
+// elongated sets are still cut into pieces of reasonable shape.
+// The hull edges returned are the extreme ones along 'axis'.
+static std::tuple<Subdivision, EdgeRef, EdgeRef>
+delaunay_dwyer(std::vector<Point>::iterator b, std::vector<Point>::iterator e, int axis)
+{
+	if (std::distance(b, e) <= 3) {
+		std::sort(b, e, [axis](Point const& p, Point const& q) { return precedes(p, q, axis); });
+		return dnc_base(b, e);
+	}
+
+	int cut = cut_axis(b, e);
+	auto mid{b}; std::advance(mid, std::distance(b, e) / 2);
+	std::nth_element(b, mid, e, [cut](Point const& p, Point const& q) { return precedes(p, q, cut); });
+
+	Subdivision L, R;
+	EdgeRef ldo, ldi, rdi, rdo;
+	std::tie(L, ldo, ldi) = delaunay_dwyer(b, mid, cut);
+	std::tie(R, rdi, rdo) = delaunay_dwyer(mid, e, cut);
+
+	std::tie(L, ldo, rdo) = dnc_merge(L, ldo, ldi, R, rdi, rdo);
+	if (cut != axis)
+		std::tie(ldo, rdo) = hull_extremes(ldo, axis);
+	return std::make_tuple(std::move(L), ldo, rdo);
+}
+
+std::tuple<Subdivision, EdgeRef, EdgeRef>
+delaunay_dwyer(std::vector<Point>::iterator b, std::vector<Point>::iterator e)
+{
+	// the result is reported along x, like delaunay_dnc's
+	return delaunay_dwyer(b, e, 0);
+}
+
+EdgeRef locate(Subdivision & s, Point x)
+{
+	// start from a sampled vertex near x
+	return locate(s, x, s.walkStart(x));
+}
+
+EdgeRef locate(Subdivision& s, Point x, EdgeRef e, WalkStats* stats)
 {
 	std::size_t N = s.edges.size(); // ?
 	do {
@@ -188,7 +285,8 @@ EdgeRef locate(Subdivision& s, Point x, EdgeRef e)
 		else if (!rightOf(x, e.Dprev()))
 			e = e.Dprev();
 		else {
-			//std::cout << s.edges.size() - N << '\n';
+			if (stats)
+				stats->add(s.edges.size() - N);
 			return e;
 		}
 	} while (N);
@@ -236,9 +334,9 @@ VertexRef insertSite(Subdivision& s, Point x)
 	return X;
 }
 
-VertexRef insertSite(Subdivision& s, Point x, EdgeRef start)
+VertexRef insertSite(Subdivision& s, Point x, EdgeRef start, WalkStats* stats)
 {
-	EdgeRef e = locate(s, x, start);
+	EdgeRef e = locate(s, x, start, stats);
 	if (!e)
 		return s.vertices.end();
 
@@ -290,45 +388,415 @@ void insertSiteSequence(Subdivision & s, std::vector<Point> seq)
 	}
 }
 
-void triangulatePseudoPolygon(Subdivision& s, EdgeRef c)
+void WalkStats::add(std::size_t n)
 {
-	VertexRef a{Org(c)}, b{Dest(c)};
+	++walks;
+	steps += n;
+	max_steps = std::max(max_steps, n);
+}
+
+double WalkStats::mean() const
+{
+	return walks ? double(steps) / walks : 0.0;
+}
 
-	if (Dest(c.Lnext().Lnext()) == a)
+// Biased randomized insertion order: after a shuffle the sites are split
+// into rounds, each about twice the size of the one before, and every
+// round is sorted along a Hilbert curve. Consecutive sites are then close
+// to each other while the order stays random enough at large scale.
+static void brio_order(std::vector<Point>& seq)
+{
+	if (seq.size() < 2)
 		return;
+	std::shuffle(seq.begin(), seq.end(), std::mt19937{});
+
+	Point lo = seq[0], hi = seq[0];
+	for (Point const& p : seq) {
+		lo.x = std::min(lo.x, p.x); hi.x = std::max(hi.x, p.x);
+		lo.y = std::min(lo.y, p.y); hi.y = std::max(hi.y, p.y);
+	}
+	Rect bounds{lo, hi - lo};
+
+	const std::size_t min_round = 64;
+	std::vector<std::pair<std::uint64_t, Point>> keyed;
+	keyed.reserve(seq.size());
+	for (Point const& p : seq)
+		keyed.emplace_back(hilbertIndex(p, bounds), p);
+
+	auto less = [](std::pair<std::uint64_t, Point> const& a, std::pair<std::uint64_t, Point> const& b) {
+		return a.first < b.first;
+	};
+	auto end = keyed.end();
+	while (std::size_t(end - keyed.begin()) > min_round) {
+		auto begin = keyed.begin() + (end - keyed.begin()) / 2;
+		std::sort(begin, end, less);
+		end = begin;
+	}
+	std::sort(keyed.begin(), end, less);
 
+	for (std::size_t i = 0; i < seq.size(); ++i)
+		seq[i] = keyed[i].second;
+}
+
+WalkStats insertSiteBatch(Subdivision& s, std::vector<Point> seq)
+{
+	WalkStats stats;
+	brio_order(seq);
+
+	EdgeRef close(s.edges.begin());
+	for (Point const& p : seq) {
+		VertexRef v = insertSite(s, p, close, &stats);
+		if (v != s.vertices.end())
+			close = v->leaves;
+	}
+	return stats;
+}
+
+namespace {
+
+std::uint32_t const no_vertex = ~std::uint32_t{0};
+std::uint64_t const no_key = ~std::uint64_t{0};
+
+// Chew's randomized algorithm for a constrained Delaunay triangulation of a
+// polygon, as Shewchuk and Brown extend it to the cavities left by
+// inserting a segment: expected linear time in the number of vertices.
+// Vertices are numbered 0 for the base's origin, 1 for its destination and
+// from 2 along the chain; every chain vertex is left of the base.
+class Cavity
+{
+public:
+	// False if the triangulation found is not the polygon's: the variant
+	// can leave a triangle turned over on the chain, depending on the order
+	bool triangulate(std::vector<Point const*> const& points, std::mt19937& random)
+	{
+		point = points.data();
+		auto m = std::uint32_t(points.size() - 1);
+		prev.resize(m + 1);
+		next.resize(m + 1);
+		order.clear();
+		for (std::uint32_t i = 2; i <= m; ++i) {
+			prev[i] = i - 1;
+			next[i] = i == m ? 0 : i + 1;
+			order.push_back(i);
+		}
+		next[1] = 2;
+		prev[0] = m;
+
+		// take the chain vertices out in random order, keeping each one's
+		// neighbours then, and put them back in reverse
+		std::shuffle(order.begin(), order.end(), random);
+		for (std::uint32_t u : order) {
+			next[prev[u]] = next[u];
+			prev[next[u]] = prev[u];
+		}
+
+		std::size_t capacity = 64;
+		while (capacity < 8 * std::size_t(m + 1))
+			capacity *= 2;
+		clear(capacity);
+		add(0, 1, order.back());
+		for (auto u = order.rbegin() + 1; u != order.rend(); ++u)
+			insert(*u, prev[*u], next[*u]);
+
+		// m - 1 triangles, none turned over and every edge between two
+		// locally Delaunay make the constrained Delaunay triangulation
+		std::size_t edges = 0;
+		for (std::size_t k = 0; k < keys.size(); ++k) {
+			if (keys[k] == no_key || values[k] == no_vertex)
+				continue;
+			++edges;
+			auto i = std::uint32_t(keys[k] >> 32);
+			auto j = std::uint32_t(keys[k]);
+			Point const& x = *point[values[k]];
+			if (orient2d(*point[i], *point[j], x) <= 0.0)
+				return false;
+			std::uint32_t y = i < j ? apex(j, i) : no_vertex;
+			if (y != no_vertex && incircle(*point[i], *point[j], x, *point[y]) > 0.0)
+				return false;
+		}
+		return edges == 3 * std::size_t(m - 1);
+	}
+
+	// the third vertex of the triangle left of i->j
+	std::uint32_t apex(std::uint32_t i, std::uint32_t j) const
+	{
+		std::size_t k = slot(key(i, j));
+		return keys[k] == key(i, j) ? values[k] : no_vertex;
+	}
+private:
+	// u between v and w on the chain: triangle v u w, then the flips it calls for
+	void insert(std::uint32_t u, std::uint32_t v, std::uint32_t w)
+	{
+		dig.clear();
+		dig.push_back({v, w});
+		while (!dig.empty()) {
+			v = dig.back().first;
+			w = dig.back().second;
+			dig.pop_back();
+			std::uint32_t x = apex(v, w);
+			if (x != no_vertex && (orient2d(*point[v], *point[u], *point[w]) <= 0.0
+				|| incircle(*point[v], *point[u], *point[w], *point[x]) > 0.0)) {
+				remove(v, w, x);
+				dig.push_back({x, w});
+				dig.push_back({v, x});
+			}
+			else
+				add(v, u, w);
+		}
+	}
+
+	void add(std::uint32_t u, std::uint32_t v, std::uint32_t w)
+	{
+		set(u, v, w);
+		set(v, w, u);
+		set(w, u, v);
+	}
+	void remove(std::uint32_t u, std::uint32_t v, std::uint32_t w)
+	{
+		set(u, v, no_vertex);
+		set(v, w, no_vertex);
+		set(w, u, no_vertex);
+	}
+
+	// the triangles, as the apex of each directed edge in an open addressing table
+	static std::uint64_t key(std::uint32_t i, std::uint32_t j)
+	{
+		return std::uint64_t(i) << 32 | j;
+	}
+
+	// the slot holding k or the empty one where it goes
+	std::size_t slot(std::uint64_t k) const
+	{
+		std::size_t mask = keys.size() - 1;
+		std::size_t i = std::size_t(k * 0x9E3779B97F4A7C15ull >> 32) & mask;
+		while (keys[i] != k && keys[i] != no_key)
+			i = (i + 1) & mask;
+		return i;
+	}
+	void set(std::uint32_t i, std::uint32_t j, std::uint32_t x)
+	{
+		std::size_t k = slot(key(i, j));
+		if (keys[k] == no_key) {
+			if (x == no_vertex)
+				return;
+			if (2 * ++used > keys.size()) {
+				rehash();
+				k = slot(key(i, j));
+			}
+			keys[k] = key(i, j);
+		}
+		values[k] = x;
+	}
+	void clear(std::size_t capacity)
+	{
+		keys.assign(capacity, no_key);
+		values.resize(capacity);
+		used = 0;
+	}
+	// drops the removed entries, growing if the rest fill a quarter
+	void rehash()
+	{
+		live.clear();
+		for (std::size_t k = 0; k < keys.size(); ++k)
+			if (keys[k] != no_key && values[k] != no_vertex)
+				live.push_back({keys[k], values[k]});
+		std::size_t capacity = keys.size();
+		while (4 * (live.size() + 1) > capacity)
+			capacity *= 2;
+		clear(capacity);
+		for (auto const& kv : live) {
+			std::size_t k = slot(kv.first);
+			keys[k] = kv.first;
+			values[k] = kv.second;
+		}
+		used = live.size() + 1;
+	}
+
+	Point const* const* point{};
+	std::vector<std::uint32_t> prev, next, order;
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> dig;
+	std::vector<std::uint64_t> keys;
+	std::vector<std::uint32_t> values;
+	std::vector<std::pair<std::uint64_t, std::uint32_t>> live;
+	std::size_t used{};
+};
+
+// A polygon waiting to be triangulated: the part left of base c. With a
+// cavity, a and b number c's ends.
+struct PolygonFrame {
+	EdgeRef c;
+	EdgeRef e, last;	// the chain edge into the apex, the one before c's origin
+	EdgeRef r;			// the diagonal splitting off the part before the apex, if any
+	std::size_t n, at;	// chain vertices and the apex's place among them, from 1
+	bool lopsided;		// the split that made the polygon left it most of its parent's vertices
+	bool refused;		// Cavity would not take the polygon or one it is part of
+	bool cavity;		// the polygon is part of the one in Cavity: a, b and apex number vertices there
+	std::uint32_t a, b, apex;
+};
+
+// triangulatePseudoPolygon's buffers, reused by each thread's later calls
+struct PolygonScratch {
+	std::vector<PolygonFrame> stack;
+	std::vector<Point const*> polygon;
+	std::vector<EdgeRef> into;
+	std::vector<std::uint32_t> seen;
+	Cavity cavity;
+};
+
+thread_local PolygonScratch polygonScratch;
+
+// lopsided polygons with at least this many chain vertices go to Cavity
+std::size_t const cavity_size = 64;
+
+}
+
+// The chain edge into the apex of the triangle on c, the first in chain
+// order whose circle with c's ends has none of the polygon's vertices
+// inside, or a null edge if there is none. Counts the chain's vertices
+// into n and the apex's place among them into at.
+static EdgeRef apexEdge(EdgeRef c, std::vector<Point const*>& polygon, std::size_t& n, std::size_t& at)
+{
+	Point const& a = Org(c)->point;
+	Point const& b = Dest(c)->point;
 	auto begin = c.Lnext();
 	auto end = c.Lprev();
-	auto last = end.Lprev();
-	auto e = begin;
-	do {
-		auto p = begin;
-		bool fnd = true;
-		do {
-			if (incircle(a, b, Dest(e), Dest(p))) {
-				fnd = false;
-				break;
+
+	// Left of ab, circles through a and b are ordered by inclusion, so one
+	// pass finds the smallest and a second the first vertex on it.
+	EdgeRef best = begin;
+	bool left = true;
+	n = 0;
+	for (auto e = begin; e != end; e = e.Lnext()) {
+		Point const& x = Dest(e)->point;
+		if (orient2d(a, b, x) <= 0.0) {
+			left = false;
+			break;
+		}
+		if (incircle(a, b, Dest(best)->point, x) > 0.0)
+			best = e;
+		++n;
+	}
+	at = 0;
+	if (left) {
+		for (auto e = begin; ; e = e.Lnext()) {
+			++at;
+			if (incircle(a, b, Dest(best)->point, Dest(e)->point) == 0.0)
+				return e;
+		}
+	}
+
+	// otherwise try each vertex against all, tested in batches
+	polygon.clear();
+	for (auto e = begin; e != end; e = e.Lnext())
+		polygon.push_back(&Dest(e)->point);
+	n = polygon.size();
+	for (auto e = begin; e != end; e = e.Lnext()) {
+		++at;
+		if (!incircleAny(a, b, Dest(e)->point, polygon.data(), polygon.size()))
+			return e;
+	}
+	return {};
+}
+
+// Hands the polygon left of c to Cavity if every vertex is left of c and
+// none comes twice round the chain (a dangling edge inside).
+static bool startCavity(EdgeRef c, PolygonScratch& scratch)
+{
+	auto& polygon = scratch.polygon;
+	auto& into = scratch.into;
+	auto& seen = scratch.seen;
+	polygon.clear();
+	into.clear();
+	seen.clear();
+	polygon.push_back(&Org(c)->point);
+	polygon.push_back(&Dest(c)->point);
+	into.push_back(c.Lprev());
+	into.push_back(c);
+	for (auto e = c.Lnext(); e != c.Lprev(); e = e.Lnext()) {
+		if (orient2d(Org(c)->point, Dest(c)->point, Dest(e)->point) <= 0.0)
+			return false;
+		polygon.push_back(&Dest(e)->point);
+		into.push_back(e);
+		seen.push_back(Dest(e).index());
+	}
+	std::sort(seen.begin(), seen.end());
+	if (std::adjacent_find(seen.begin(), seen.end()) != seen.end())
+		return false;
+
+	// a few tries, then the polygon is left to apexEdge
+	std::mt19937 random;
+	for (int tries = 0; tries < 3; ++tries)
+		if (scratch.cavity.triangulate(polygon, random))
+			return true;
+	return false;
+}
+
+// the polygon left of c, the part of 'whole' before its apex or after it
+static PolygonFrame polygonPart(EdgeRef c, PolygonFrame const& whole, bool before,
+	std::uint32_t a, std::uint32_t b)
+{
+	std::size_t n = whole.cavity ? 0 : before ? whole.at - 1 : whole.n - whole.at;
+	bool lopsided = n >= cavity_size && 4 * n > 3 * whole.n;
+	return {c, {}, {}, {}, n, 0, lopsided, whole.refused, whole.cavity, a, b, no_vertex};
+}
+
+void triangulatePseudoPolygon(Subdivision& s, EdgeRef c)
+{
+	PolygonScratch& scratch = polygonScratch;
+	auto& stack = scratch.stack;
+
+	// Each polygon is split at the apex of the triangle on its base, the
+	// part before the apex first. The apex is found by a linear scan, which
+	// is quadratic over the whole if the splits keep coming out lopsided:
+	// a lopsided part is triangulated by Cavity in expected linear time
+	// instead and the apexes of its parts then looked up.
+	stack.clear();
+	stack.push_back({c, {}, {}, {}, 0, 0, false, false, false, 0, 1, no_vertex});
+	while (!stack.empty()) {
+		PolygonFrame& f = stack.back();
+		if (!f.e) {
+			if (Dest(f.c.Lnext().Lnext()) == Org(f.c)) {
+				stack.pop_back();
+				continue;
 			}
-			p = p.Lnext();
-		} while (p != end);
-
-		if (fnd) {
-			bool done = false;
-			if (e != begin) {
-				auto r = s.connect(e, begin);
-				triangulatePseudoPolygon(s, r);
-				done = true;
+			f.last = f.c.Lprev().Lprev();
+			if (f.lopsided && !f.refused && !f.cavity) {
+				// what stops it mostly stays in the parts: not tried again there
+				f.cavity = startCavity(f.c, scratch);
+				f.refused = !f.cavity;
+				if (f.cavity) {
+					f.a = 0;
+					f.b = 1;
+				}
 			}
-			if (e != last) {
-				auto l = s.connect( done? e.Dprev():e , c);
-				l = l.Sym();
-				triangulatePseudoPolygon(s, l);
+			if (f.cavity) {
+				f.apex = scratch.cavity.apex(f.a, f.b);
+				f.e = f.apex == no_vertex ? EdgeRef{} : scratch.into[f.apex];
+			}
+			else
+				f.e = apexEdge(f.c, scratch.polygon, f.n, f.at);
+			if (!f.e) {
+				stack.pop_back();
+				continue;
+			}
+			auto begin = f.c.Lnext();
+			if (f.e != begin) {
+				f.r = s.connect(f.e, begin);
+				PolygonFrame r = polygonPart(f.r, f, true, f.apex, f.b);
+				stack.push_back(r);
+				continue;
 			}
-			break;
 		}
-		e = e.Lnext();
-	} while (e != end);
 
+		// the part before the apex is done: on to the part after it
+		PolygonFrame g = stack.back();
+		stack.pop_back();
+		if (g.e != g.last) {
+			// r's side has edges at the apex by now, but r is still on c's face
+			auto l = s.connect(g.r ? g.r.Sym() : g.e, g.c).Sym();
+			stack.push_back(polygonPart(l, g, false, g.a, g.apex));
+		}
+	}
 }
 
 EdgeRef insertEdge(Subdivision& s, VertexRef a, VertexRef b)
@@ -338,8 +806,11 @@ EdgeRef insertEdge(Subdivision& s, VertexRef a, VertexRef b)
 	EdgeRef p = e;
 	do {
 		if (Dest(e) == b) {
-			e.data().fixed = true;
-			e.Sym().data().fixed = true;
+			if (!e.data().fixed) {
+				e.data().fixed = true;
+				e.Sym().data().fixed = true;
+				s.segments.add(e);
+			}
 			return e;
 		}
 		e = e.Onext();
@@ -385,6 +856,7 @@ EdgeRef insertEdge(Subdivision& s, VertexRef a, VertexRef b)
 
 	c.data().fixed = true;
 	c.Sym().data().fixed = true;
+	s.segments.add(c);
 
 	triangulatePseudoPolygon(s, c);
 	triangulatePseudoPolygon(s, c.Sym());
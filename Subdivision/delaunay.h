@@ -3,6 +3,7 @@
 #include <tuple>
 #include <vector>
 #include <utility>
+#include <thread>
 
 void swap(EdgeRef e);
 bool rightOf(VertexRef v, EdgeRef e);
@@ -16,16 +17,44 @@ bool rightOf(Point p, EdgeRef e);
 
 bool incircle(VertexRef a, VertexRef b, VertexRef c, VertexRef d);
 
+// takes distinct sites in sorted order and lists their vertices in it
 std::tuple<Subdivision, EdgeRef, EdgeRef>
 delaunay_dnc(std::vector<Point>::iterator b, std::vector<Point>::iterator e);
 
+// same as delaunay_dnc, recursing on up to 'threads' threads;
+// ranges shorter than 'cutoff' are triangulated serially
+std::tuple<Subdivision, EdgeRef, EdgeRef>
+delaunay_dnc_parallel(std::vector<Point>::iterator b, std::vector<Point>::iterator e,
+	unsigned threads = std::thread::hardware_concurrency(), std::size_t cutoff = 1 << 16);
+
+// divide and conquer with cuts alternating between vertical and horizontal;
+// takes distinct sites in any order (and reorders them), returns the same
+// hull edges as delaunay_dnc
+std::tuple<Subdivision, EdgeRef, EdgeRef>
+delaunay_dwyer(std::vector<Point>::iterator b, std::vector<Point>::iterator e);
+
+// lengths (in steps) of point location walks
+struct WalkStats {
+	std::size_t walks{};
+	std::size_t steps{};
+	std::size_t max_steps{};
+	void add(std::size_t n);
+	double mean() const;
+};
+
 EdgeRef locate(Subdivision& s, Point x);
-EdgeRef locate(Subdivision & s, Point x, EdgeRef e);
+EdgeRef locate(Subdivision & s, Point x, EdgeRef e, WalkStats* stats = nullptr);
 bool onEdge(Point c, EdgeRef e);
 VertexRef insertSite(Subdivision& s, Point x);
-VertexRef insertSite(Subdivision& s, Point x, EdgeRef start);
+VertexRef insertSite(Subdivision& s, Point x, EdgeRef start, WalkStats* stats = nullptr);
 void insertSiteSequence(Subdivision& s, std::vector<Point> seq);
+// inserts the sites in biased randomized rounds, each round in Hilbert
+// curve order, and reports the point location walks
+WalkStats insertSiteBatch(Subdivision& s, std::vector<Point> seq);
 
+// triangulates the polygon left of c, the cavity a segment leaves on one
+// side, constrained Delaunay; no recursion, and no allocation once the
+// thread's scratch space has grown
 void triangulatePseudoPolygon(Subdivision& s, EdgeRef c);
 
 EdgeRef insertEdge(Subdivision&, VertexRef, VertexRef);
\ No newline at end of file
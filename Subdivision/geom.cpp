@@ -111,6 +111,32 @@ std::array<Point, 3> triangleCover(std::vector<Point>& pts)
 	return trian;
 }
 
+std::uint64_t hilbertIndex(Point p, Rect const& bounds)
+{
+	const std::uint32_t n = 1u << 16;
+	auto grid = [n](double t, double origin, double len) {
+		double cell = len > 0.0 ? (t - origin) / len * (n - 1) : 0.0;
+		return std::uint32_t(std::min(std::max(cell, 0.0), double(n - 1)));
+	};
+	std::uint32_t x = grid(p.x, bounds.origin.x, bounds.dir.x);
+	std::uint32_t y = grid(p.y, bounds.origin.y, bounds.dir.y);
+
+	std::uint64_t d = 0;
+	for (std::uint32_t s = n / 2; s > 0; s /= 2) {
+		std::uint32_t rx = (x & s) ? 1 : 0;
+		std::uint32_t ry = (y & s) ? 1 : 0;
+		d += std::uint64_t(s) * s * ((3 * rx) ^ ry);
+		if (ry == 0) { // rotate the quadrant
+			if (rx == 1) {
+				x = n - 1 - x;
+				y = n - 1 - y;
+			}
+			std::swap(x, y);
+		}
+	}
+	return d;
+}
+
 Point circumCenter(Point const& a, Point const& b, Point const& c)
 {
 	double x = sqNorm(a)*(b.y - c.y) + sqNorm(b)*(c.y - a.y) + sqNorm(c)*(a.y - b.y);
@@ -126,39 +152,50 @@ Circle circumCircle(Point const& a, Point const& b, Point const& c)
 	return Circle{p,dist(p,a)};
 }
 
-double circumRadius(Point const& p1, Point const& p2, Point const& p3)
+// R = abc / 4A and 2A = |orient2d|, so R^2 = a^2 b^2 c^2 / (4 orient2d^2):
+// squared edge lengths and one determinant, no square roots
+double circumRadius2(Point const& p1, Point const& p2, Point const& p3)
 {
-	double a = norm(p1 - p2);
-	double b = norm(p2 - p3);
-	double c = norm(p3 - p1);
+	double cross = orient2d(p1, p2, p3);
+	return sqNorm(p1 - p2)*sqNorm(p2 - p3)*sqNorm(p3 - p1) / (4.0*cross*cross);
+}
 
-	double d = a*b*c / sqrt((a + b + c)*(-a + b + c)*(a - b + c)*(a + b - c));
-	return d;
+double quality_measure2(Point const& p1, Point const& p2, Point const& p3)
+{
+	double a = sqNorm(p1 - p2);
+	double b = sqNorm(p2 - p3);
+	double c = sqNorm(p3 - p1);
+	double cross = orient2d(p1, p2, p3);
+
+	return a*b*c / (4.0*cross*cross) / std::min({a,b,c});
 }
 
-double quality_measure(Point const& p1, Point const& p2, Point const& p3)
+double circumRadius(Point const& p1, Point const& p2, Point const& p3)
 {
-	double a = norm(p1 - p2);
-	double b = norm(p2 - p3);
-	double c = norm(p3 - p1);
-	double min_edge_len = std::min({a,b,c});
+	return sqrt(circumRadius2(p1, p2, p3));
+}
 
-	double circumradius = a*b*c / sqrt((a + b + c)*(-a + b + c)*(a - b + c)*(a + b - c));
+double quality_measure(Point const& p1, Point const& p2, Point const& p3)
+{
+	return sqrt(quality_measure2(p1, p2, p3));
+}
 
-	return circumradius / min_edge_len;
+TriangleGeometry triangleGeometry(Point const& p1, Point const& p2, Point const& p3)
+{
+	double a = sqNorm(p1 - p2);
+	double b = sqNorm(p2 - p3);
+	double c = sqNorm(p3 - p1);
+	double cross = orient2d(p1, p2, p3);
+	double radius2 = a*b*c / (4.0*cross*cross);
+	double shortest2 = std::min({a,b,c});
+
+	return{circumCenter(p1, p2, p3), radius2, shortest2, radius2 / shortest2,
+		std::abs(cross) / 2.0};
 }
 
 double triangleArea(Point const& p1, Point const& p2, Point const& p3)
 {
-	double a = norm(p1 - p2);
-	double b = norm(p2 - p3);
-	double c = norm(p3 - p1);
-
-	std::array<double, 3> lens{a,b,c};
-	double  p = KahanSum(lens) / 2.0;
-	double area = sqrt(p*(p-a)*(p-b)*(p-c));
-	
-	return area;
+	return std::abs(orient2d(p1, p2, p3)) / 2.0;
 }
 
 Point off_center(Point A, Point B, Point C, double beta_req)
@@ -2,6 +2,7 @@
 #include "Point.h"
 #include <vector>
 #include <array>
+#include <cstdint>
 
 struct Rect {
 	Point origin;
@@ -17,6 +18,8 @@ std::vector<Point> rectHull(Rect r, int Nx, int Ny);
 std::vector<Point> circleHull(Point cen, double rad, int N = 20);
 std::vector<Point> rectUniform(Rect, int);
 std::array<Point, 3> triangleCover(std::vector<Point>&);
+// position of p along a Hilbert curve filling 'bounds' (a 2^16 x 2^16 grid)
+std::uint64_t hilbertIndex(Point p, Rect const& bounds);
 
 
 template <class Fun>
@@ -43,6 +46,21 @@ double quality_measure(Point const& p1, Point const& p2, Point const& p3);
 Point circumCenter(Point const& a, Point const& b, Point const& c);
 Circle circumCircle(Point const& a, Point const& b, Point const& c);
 double circumRadius(Point const& p1, Point const& p2, Point const& p3);
+// squares of quality_measure and circumRadius, computed without square
+// roots; compare them against squared thresholds
+double quality_measure2(Point const& p1, Point const& p2, Point const& p3);
+double circumRadius2(Point const& p1, Point const& p2, Point const& p3);
+
+// What the refinement asks of a triangle, each value as the functions
+// above and below compute it; lengths and ratios are squared.
+struct TriangleGeometry {
+	Point center;
+	double radius2; // circumradius
+	double shortest2; // shortest edge length
+	double ratio2; // circumradius to shortest edge
+	double area;
+};
+TriangleGeometry triangleGeometry(Point const& p1, Point const& p2, Point const& p3);
 
 template <class T, std::size_t N>
 T KahanSum(std::array<T,N> const& v)
@@ -0,0 +1,340 @@
+#include "input.h"
+#include "mapped.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#if defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+
+// records per chunk are parsed serially below this many bytes
+static std::size_t const chunk_bytes = std::size_t{1} << 20;
+
+static bool fail(char const* path, char const* what)
+{
+	std::cerr << path << ": " << what << '\n';
+	return false;
+}
+
+static bool space(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// where a number may end
+static bool separator(char const* p, char const* e)
+{
+	return p == e || space(*p) || *p == '\n' || *p == '#';
+}
+
+static char const* next_line(char const* p, char const* e)
+{
+	auto nl = static_cast<char const*>(std::memchr(p, '\n', e - p));
+	return nl ? nl + 1 : e;
+}
+
+// the start of the next line with data at or after p, or e
+static char const* data_line(char const* p, char const* e)
+{
+	for (;;) {
+		while (p != e && space(*p))
+			++p;
+		if (p == e || (*p != '\n' && *p != '#'))
+			return p;
+		p = next_line(p, e);
+	}
+}
+
+// parses the number at p into x, returns its end or nullptr
+static char const* number(char const* p, char const* e, double& x)
+{
+	// from_chars takes no plus sign
+	if (p != e && *p == '+' && p + 1 != e && (std::isdigit(static_cast<unsigned char>(p[1])) || p[1] == '.'))
+		++p;
+#ifdef __cpp_lib_to_chars
+	auto r = std::from_chars(p, e, x);
+	if (r.ec != std::errc{})
+		return nullptr;
+	char const* end = r.ptr;
+#else
+	// strtod needs a terminated copy: the mapping is not
+	char buf[64];
+	std::size_t n = 0;
+	while (n + 1 < sizeof buf && !separator(p + n, e)) {
+		buf[n] = p[n];
+		++n;
+	}
+	buf[n] = '\0';
+	char* stop;
+	x = std::strtod(buf, &stop);
+	if (stop == buf)
+		return nullptr;
+	char const* end = p + (stop - buf);
+#endif
+	return separator(end, e) && std::isfinite(x) ? end : nullptr;
+}
+
+// Reads the next record: the numbers on the next line with data, up to n
+// of them into 'fields' (the rest of the line is skipped). Returns how
+// many were read, 0 at the end of the text and -1 on a malformed number.
+static int record(char const*& p, char const* e, double* fields, int n)
+{
+	p = data_line(p, e);
+	if (p == e)
+		return 0;
+	int k = 0;
+	while (k < n) {
+		char const* q = number(p, e, fields[k]);
+		if (!q)
+			return -1;
+		++k;
+		p = q;
+		while (p != e && space(*p))
+			++p;
+		if (separator(p, e))
+			break;
+	}
+	p = next_line(p, e);
+	return k;
+}
+
+// the end of the next n records from p, or nullptr if there are fewer
+static char const* skip_records(char const* p, char const* e, std::size_t n)
+{
+	for (std::size_t i = 0; i < n; ++i) {
+		p = data_line(p, e);
+		if (p == e)
+			return nullptr;
+		p = next_line(p, e);
+	}
+	return p;
+}
+
+// Parses the records of [b, e), each of at least n numbers, in chunks on
+// up to 'threads' threads, and appends the first n numbers of each to
+// 'out' in file order; false on a malformed or short record.
+static bool parse_records(char const* b, char const* e, int n, std::vector<double>& out, unsigned threads)
+{
+	std::size_t chunks = chunk_count(e - b, threads, chunk_bytes);
+	std::vector<char const*> cuts(chunks + 1, e);
+	cuts[0] = b;
+	for (std::size_t k = 1; k < chunks; ++k)
+		cuts[k] = next_line(std::max(b + (e - b) / chunks * k, cuts[k - 1]), e);
+
+	std::vector<std::vector<double>> parts(chunks);
+	std::vector<char> ok(chunks, true);
+	run_chunks(chunks, chunks, [&](std::size_t, std::size_t, std::size_t k) {
+		char const* p = cuts[k];
+		double fields[8];
+		int got;
+		while ((got = record(p, cuts[k + 1], fields, n)) > 0) {
+			if (got < n) {
+				ok[k] = false;
+				return;
+			}
+			parts[k].insert(parts[k].end(), fields, fields + n);
+		}
+		ok[k] = got == 0;
+	});
+	if (std::find(ok.begin(), ok.end(), false) != ok.end())
+		return false;
+
+	std::size_t total = out.size();
+	for (auto const& part : parts)
+		total += part.size();
+	out.reserve(total);
+	for (auto const& part : parts)
+		out.insert(out.end(), part.begin(), part.end());
+	return true;
+}
+
+// an index field as an integer in [0, limit)
+static bool to_index(double x, double base, std::size_t limit, std::uint32_t& i)
+{
+	x -= base;
+	if (!(x >= 0 && x < double(limit)) || x != std::floor(x))
+		return false;
+	i = std::uint32_t(x);
+	return true;
+}
+
+bool read_points(char const* path, std::vector<Point>& points, unsigned threads)
+{
+	MappedFile file(path);
+	if (!file.is_open())
+		return fail(path, "cannot open the file");
+	std::vector<double> xy;
+	if (!parse_records(file.data(), file.data() + file.size(), 2, xy, threads))
+		return fail(path, "expected two coordinates on each line");
+
+	std::vector<Point> read(xy.size() / 2);
+	for (std::size_t i = 0; i < read.size(); ++i)
+		read[i] = Point{xy[2 * i], xy[2 * i + 1]};
+	points.swap(read);
+	return true;
+}
+
+// Reads the vertex section of a .node or .poly file at p and advances p
+// past it; the section runs to e if 'to_end' (a .node file), else it is
+// as long as its count says. 'base' gets the number of the first vertex.
+static bool read_vertices(char const* path, char const*& p, char const* e, bool to_end,
+	std::vector<Point>& points, double& base, unsigned threads)
+{
+	double header[2];
+	int got = record(p, e, header, 2);
+	if (got < 1 || header[0] < 0 || header[0] != std::floor(header[0]))
+		return fail(path, "expected the vertex count");
+	if (got == 2 && header[1] != 2)
+		return fail(path, "only two dimensions are supported");
+	std::size_t count = std::size_t(header[0]);
+	if (count > (std::size_t{1} << 30))
+		return fail(path, "too many vertices");
+
+	char const* end = to_end ? e : skip_records(p, e, count);
+	if (!end)
+		return fail(path, "fewer vertices than the count says");
+	std::vector<double> fields;
+	if (!parse_records(p, end, 3, fields, threads))
+		return fail(path, "expected an index and two coordinates for each vertex");
+	if (fields.size() != 3 * count)
+		return fail(path, "more vertices than the count says");
+
+	base = count ? fields[0] : 0;
+	if (base != 0 && base != 1)
+		return fail(path, "vertices must be numbered from 0 or 1");
+	std::vector<Point> read(count);
+	for (std::size_t i = 0; i < count; ++i) {
+		if (fields[3 * i] != base + double(i))
+			return fail(path, "vertices must be numbered consecutively");
+		read[i] = Point{fields[3 * i + 1], fields[3 * i + 2]};
+	}
+	points.swap(read);
+	p = end;
+	return true;
+}
+
+bool read_node(char const* path, std::vector<Point>& points, unsigned threads)
+{
+	MappedFile file(path);
+	if (!file.is_open())
+		return fail(path, "cannot open the file");
+	char const* p = file.data();
+	double base;
+	return read_vertices(path, p, p + file.size(), true, points, base, threads);
+}
+
+bool read_poly(char const* path, Pslg& pslg, unsigned threads)
+{
+	MappedFile file(path);
+	if (!file.is_open())
+		return fail(path, "cannot open the file");
+	char const* p = file.data();
+	char const* e = p + file.size();
+
+	Pslg read;
+	double base;
+	if (!read_vertices(path, p, e, false, read.points, base, threads))
+		return false;
+	if (read.points.empty()) {
+		std::string node = path;
+		if (node.size() >= 5 && node.compare(node.size() - 5, 5, ".poly") == 0)
+			node.erase(node.size() - 5);
+		node += ".node";
+		MappedFile nodes(node.c_str());
+		if (!nodes.is_open())
+			return fail(node.c_str(), "cannot open the file");
+		char const* q = nodes.data();
+		if (!read_vertices(node.c_str(), q, q + nodes.size(), true, read.points, base, threads))
+			return false;
+	}
+
+	double header[1];
+	if (record(p, e, header, 1) != 1 || header[0] < 0 || header[0] != std::floor(header[0]))
+		return fail(path, "expected the segment count");
+	std::size_t count = std::size_t(header[0]);
+	char const* end = count > (std::size_t{1} << 30) ? nullptr : skip_records(p, e, count);
+	if (!end)
+		return fail(path, "fewer segments than the count says");
+	std::vector<double> fields;
+	if (!parse_records(p, end, 3, fields, threads))
+		return fail(path, "expected an index and two endpoints for each segment");
+	read.segments.resize(count);
+	for (std::size_t i = 0; i < count; ++i) {
+		auto& s = read.segments[i];
+		if (!to_index(fields[3 * i + 1], base, read.points.size(), s.first)
+			|| !to_index(fields[3 * i + 2], base, read.points.size(), s.second))
+			return fail(path, "segment endpoint is not a vertex");
+	}
+	p = end;
+
+	// the hole section may be missing altogether
+	if (data_line(p, e) != e) {
+		if (record(p, e, header, 1) != 1 || header[0] < 0 || header[0] != std::floor(header[0]))
+			return fail(path, "expected the hole count");
+		count = std::size_t(header[0]);
+		end = count > (std::size_t{1} << 30) ? nullptr : skip_records(p, e, count);
+		if (!end)
+			return fail(path, "fewer holes than the count says");
+		fields.clear();
+		if (!parse_records(p, end, 3, fields, threads))
+			return fail(path, "expected an index and two coordinates for each hole");
+		read.holes.resize(count);
+		for (std::size_t i = 0; i < count; ++i)
+			read.holes[i] = Point{fields[3 * i + 1], fields[3 * i + 2]};
+	}
+
+	pslg = std::move(read);
+	return true;
+}
+
+bool closed_loops(Pslg const& pslg, std::vector<std::vector<Point>>& loops)
+{
+	std::uint32_t const none = ~std::uint32_t{0};
+	// the (up to) two segments at each point
+	std::vector<std::uint32_t> at(2 * pslg.points.size(), none);
+	for (std::uint32_t s = 0; s < pslg.segments.size(); ++s) {
+		auto const& seg = pslg.segments[s];
+		if (seg.first == seg.second)
+			return false;
+		for (std::uint32_t v : {seg.first, seg.second}) {
+			std::uint32_t* slot = &at[2 * v];
+			if (slot[0] == none)
+				slot[0] = s;
+			else if (slot[1] == none)
+				slot[1] = s;
+			else
+				return false;
+		}
+	}
+	for (std::size_t i = 0; i < pslg.points.size(); ++i)
+		if ((at[2 * i] == none) != (at[2 * i + 1] == none))
+			return false;
+
+	std::vector<std::vector<Point>> found;
+	std::vector<char> done(pslg.segments.size(), false);
+	for (std::uint32_t s = 0; s < pslg.segments.size(); ++s) {
+		if (done[s]) continue;
+		std::vector<Point> loop;
+		std::uint32_t start = pslg.segments[s].first;
+		std::uint32_t v = start;
+		std::uint32_t seg = s;
+		do {
+			done[seg] = true;
+			loop.push_back(pslg.points[v]);
+			auto const& ends = pslg.segments[seg];
+			v = ends.first == v ? ends.second : ends.first;
+			seg = at[2 * v] == seg ? at[2 * v + 1] : at[2 * v];
+		} while (v != start);
+		found.push_back(std::move(loop));
+	}
+	loops.swap(found);
+	return true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "Point.h"
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Readers for point sets and planar straight-line graphs in text files.
+// A file is mapped into memory, split into chunks at line breaks and the
+// chunks are parsed in parallel with std::from_chars (strtod where the
+// library lacks it). Blank lines and everything after a '#' are skipped.
+// On failure a reader prints what went wrong to std::cerr, leaves its
+// output alone and returns false.
+
+// points and the segments joining them (0-based indices into points)
+struct Pslg {
+	std::vector<Point> points;
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> segments;
+	std::vector<Point> holes;
+};
+
+// "x y" on each line, as in points.txt; further numbers on a line are ignored
+bool read_points(char const* path, std::vector<Point>& points,
+	unsigned threads = std::thread::hardware_concurrency());
+
+// Triangle's .node format: a line "vertices 2 attributes markers", then
+// "index x y [attributes] [marker]" for each vertex, numbered from 0 or 1
+bool read_node(char const* path, std::vector<Point>& points,
+	unsigned threads = std::thread::hardware_concurrency());
+
+// Triangle's .poly format: vertices as in a .node file (a count of 0 takes
+// them from the .node file of the same name), then a line "segments
+// markers" and "index a b [marker]" for each segment, then a line "holes"
+// and "index x y" for each hole; regional attributes are ignored
+bool read_poly(char const* path, Pslg& pslg,
+	unsigned threads = std::thread::hardware_concurrency());
+
+// The segments chained into closed loops, each the points of the loop in
+// order, ready for insertClosedLoop; false if some point is on other than
+// zero or two segments.
+bool closed_loops(Pslg const& pslg, std::vector<std::vector<Point>>& loops);
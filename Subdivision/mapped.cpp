@@ -0,0 +1,82 @@
+#include "mapped.h"
+
+#ifdef _WIN32
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+MappedFile::MappedFile(char const* path)
+{
+	HANDLE f = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (f == INVALID_HANDLE_VALUE)
+		return;
+	file = f;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(f, &size))
+		return;
+	if (size.QuadPart == 0) {
+		open = true;
+		return;
+	}
+	HANDLE m = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m)
+		return;
+	mapping = m;
+	void* view = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+	if (!view)
+		return;
+	begin = static_cast<char const*>(view);
+	length = static_cast<std::size_t>(size.QuadPart);
+	open = true;
+}
+
+MappedFile::~MappedFile()
+{
+	if (begin)
+		UnmapViewOfFile(begin);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file)
+		CloseHandle(file);
+}
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(char const* path)
+{
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+		return;
+	struct stat st;
+	if (fstat(fd, &st) == 0) {
+		if (st.st_size == 0) {
+			open = true;
+		}
+		else {
+			void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p != MAP_FAILED) {
+				madvise(p, st.st_size, MADV_SEQUENTIAL);
+				begin = static_cast<char const*>(p);
+				length = static_cast<std::size_t>(st.st_size);
+				open = true;
+			}
+		}
+	}
+	// the mapping stays valid without the descriptor
+	close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+	if (begin)
+		munmap(const_cast<char*>(begin), length);
+}
+
+#endif
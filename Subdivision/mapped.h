@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+
+// A whole file mapped read-only into memory (mmap on POSIX, a file
+// mapping on Windows). An empty file opens with size 0 and no data.
+class MappedFile
+{
+public:
+	explicit MappedFile(char const* path);
+	~MappedFile();
+	MappedFile(MappedFile const&) = delete;
+	MappedFile& operator=(MappedFile const&) = delete;
+
+	bool is_open() const { return open; }
+	char const* data() const { return begin; }
+	std::size_t size() const { return length; }
+private:
+	bool open{};
+	char const* begin{};
+	std::size_t length{};
+#ifdef _WIN32
+	void* file{};
+	void* mapping{};
+#endif
+};
@@ -4,30 +4,31 @@
 #include "delaunay.h"
 #include "predicates.h"
 #include "geom.h"
+#include "parallel.h"
+#include "checkpoint.h"
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <functional>
+#include <iostream>
 #include "boost/math/constants/constants.hpp"
 
 void init_faces(Subdivision& s)
 {
 	for (auto qref = s.edges.begin(); qref != s.edges.end(); ++qref)
 	{
-		EdgeRef e(qref, 1);
-		//if (e.data().var.which() == 0) { // if references VertexRef
-		//	e = e.Rot();
-		//}
-
-		e.data().var = s.faces.end();
-		e.Sym().data().var = s.faces.end();
+		EdgeRef e(qref);
+		Left(e) = s.faces.end();
+		Right(e) = s.faces.end();
 	}
 
 	EdgeRef start{s.edges.begin(),1};
-	//if (start.data().var.which() == 0) { // if references VertexRef
-	//	start = start.Rot();
-	//}
 
 	std::vector<EdgeRef> stack{start};
 
-	auto face = [](EdgeRef e) {
-		return boost::get<Subdivision::FaceRef>(e.data().var);
+	// 'e' is a dual edge, its origin is a face
+	auto face = [](EdgeRef e) -> FaceRef& {
+		return Left(e.Rot());
 	};
 
 	while (!stack.empty())
@@ -35,11 +36,10 @@ void init_faces(Subdivision& s)
 		EdgeRef e = stack.back(); stack.pop_back();
 		if (face(e) != s.faces.end())
 			continue;
-		s.faces.push_back({});
-		auto f = std::prev(s.faces.end());
+		auto f = s.faces.add();
 		auto end = e;
 		do {
-			e.data().var = f;
+			face(e) = f;
 			if (face(e.Sym()) == s.faces.end())
 				stack.push_back(e.Sym());
 			e = e.Onext();
@@ -121,11 +121,14 @@ EdgeRef splitBoundaryEdge(Subdivision& s, EdgeRef e)
 	if (Left(e)->mark)
 		e = e.Sym();
 
+	auto serial = s.segments.remove(e);
 	auto e1 = s.splitVertex(e, e.Oprev(), midpoint(e));
 	e1.data().boundary = true;
 	e1.Sym().data().boundary = true;
 	e1.data().fixed = true;
 	e1.Sym().data().fixed = true;
+	s.segments.add(e, serial);
+	s.segments.add(e1);
 
 	e1 = e1.Lnext();
 	auto e2 = e1.Onext();
@@ -172,9 +175,12 @@ EdgeRef splitRegularEdge(Subdivision& s, EdgeRef e)
 
 	auto mark = Left(e)->mark;
 
+	auto serial = s.segments.remove(e);
 	auto e1 = s.splitVertex(e, e.Oprev(), midpoint(e));
 	e1.data().fixed = true;
 	e1.Sym().data().fixed = true;
+	s.segments.add(e, serial);
+	s.segments.add(e1);
 
 
 	e1 = e1.Lnext();
@@ -210,29 +216,50 @@ EdgeRef splitRegularEdge(Subdivision& s, EdgeRef e)
 
 void splitEdges(Subdivision & dt)
 {
-	bool all_done = false;
-	while (!all_done)
+	// Segments are split in the order of the edges list, first encroached
+	// first, as a rescan after every split would. Only segments of the
+	// triangles around a new vertex can have become encroached, so only
+	// those go back to the queue; the rest are tested once.
+	std::map<EdgeRef, std::size_t> order;
+	using Item = std::pair<std::size_t, EdgeRef>;
+	std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+
+	for (auto qref = dt.edges.begin(); qref != dt.edges.end(); ++qref)
 	{
-		all_done = true;
-		for (auto qref = dt.edges.begin(); qref != dt.edges.end(); ++qref)
-		{
-			EdgeRef e(qref);
-			if (e.data().var.which() != 0)
-				e = e.Rot();
-
-			if (!e.data().fixed) continue;
-			if (encroaches(e, Dest(e.Onext())) || encroaches(e, Dest(e.Oprev())))
-			{
-				if (e.data().boundary)
-					splitBoundaryEdge(dt, e);
-				else {
-					assert(e.data().fixed);
-					splitRegularEdge(dt, e);
-				}
-				all_done = false;
-				break;
-			}
+		EdgeRef e(qref);
+		if (!e.data().fixed) continue;
+		queue.emplace(order.size(), e);
+		order.emplace(e, order.size());
+	}
+
+	while (!queue.empty())
+	{
+		EdgeRef e = queue.top().second;
+		queue.pop();
+		if (!encroaches(e, Dest(e.Onext())) && !encroaches(e, Dest(e.Oprev())))
+			continue;
+
+		// Org(x) is the new vertex
+		EdgeRef x;
+		if (e.data().boundary)
+			x = splitBoundaryEdge(dt, e);
+		else {
+			assert(e.data().fixed);
+			x = splitRegularEdge(dt, e);
 		}
+
+		auto f = x;
+		do {
+			for (EdgeRef g : {f, f.Lnext()}) {
+				if (!g.data().fixed) continue;
+				if (g.Sym() < g) // as the edges list visits it
+					g = g.Sym();
+				// the one new subsegment is last in the edges list
+				auto it = order.emplace(g, order.size()).first;
+				queue.emplace(it->second, g);
+			}
+			f = f.Onext();
+		} while (f != x);
 	}
 }
 
@@ -278,24 +305,16 @@ VertexRef insertMeshSite(Subdivision& s, Point x)
 	}
 
 	// check for conflicts
-	for (auto qref = s.edges.begin(); qref != s.edges.end(); ++qref)
+	if (EdgeRef seg = s.encroachedSegment(x))
 	{
-		EdgeRef e(qref);
-		if (e.data().var.which() != 0)
-			e = e.Rot();
-
-		if (!e.data().fixed) continue;
-		if (encroaches(e, x))
-		{
-			//std::cout << "conflict with edge " << e.data().boundary << '\n';
-			if (e.data().boundary)
-				splitBoundaryEdge(s, e);
-			else {
-				assert(e.data().fixed);
-				splitRegularEdge(s, e);
-			}
-			return s.vertices.end();
+		//std::cout << "conflict with edge " << seg.data().boundary << '\n';
+		if (seg.data().boundary)
+			splitBoundaryEdge(s, seg);
+		else {
+			assert(seg.data().fixed);
+			splitRegularEdge(s, seg);
 		}
+		return s.vertices.end();
 	}
 
 	//std::cout << "normal insertion\n";
@@ -338,30 +357,38 @@ VertexRef insertMeshSite(Subdivision& s, Point x)
 }
 
 
-bool eliminate_worst_triangle(Subdivision& dt, double min_ratio)
+// the queue's pick if there is one, a scan of the faces otherwise; the
+// ratio comes squared
+static std::tuple<FaceRef, double> find_worst(Subdivision& dt, FaceQueue* queue)
 {
-	FaceRef face; double ratio;
-	std::tie(face, ratio) = find_worst(dt);
-	if (ratio <= min_ratio) return false;
-	auto e = face->bounds;
-	Point cc = circumCenter(Org(e)->point, Dest(e)->point, Dest(e.Onext())->point);
-	insertMeshSite(dt, cc);
+	return queue ? queue->worst() : find_worst2(dt);
+}
+
+static std::tuple<FaceRef, double> find_biggest(Subdivision& dt, FaceQueue* queue)
+{
+	return queue ? queue->biggest() : find_biggest(dt);
+}
+
+bool eliminate_worst_triangle(Subdivision& dt, double min_ratio, FaceQueue* queue)
+{
+	FaceRef face; double ratio2;
+	std::tie(face, ratio2) = find_worst(dt, queue);
+	if (ratio2 <= min_ratio * min_ratio) return false;
+	insertMeshSite(dt, dt.geometry(face).center);
 	return true;
 }
 
-bool eliminate_worst_triangle(Subdivision& dt, double min_ratio, double min_area)
+bool eliminate_worst_triangle(Subdivision& dt, double min_ratio, double min_area, FaceQueue* queue)
 {
-	FaceRef face; double ratio;
-	std::tie(face, ratio) = find_worst(dt);
-	if (ratio <= min_ratio) {
+	FaceRef face; double ratio2;
+	std::tie(face, ratio2) = find_worst(dt, queue);
+	if (ratio2 <= min_ratio * min_ratio) {
 		double area;
-		std::tie(face, area) = find_biggest(dt);
+		std::tie(face, area) = find_biggest(dt, queue);
 		if (area <= min_area)
 			return false;
 	}
-	auto e = face->bounds;
-	Point cc = circumCenter(Org(e)->point, Dest(e)->point, Dest(e.Onext())->point);
-	insertMeshSite(dt, cc);
+	insertMeshSite(dt, dt.geometry(face).center);
 	return true;
 }
 
@@ -369,9 +396,7 @@ bool eliminate_bad_triangle(Subdivision& dt, double min_ratio)
 {
 	auto face = find_bad(dt, min_ratio);
 	if (face == dt.faces.end()) return false;
-	auto e = face->bounds;
-	Point cc = circumCenter(Org(e)->point, Dest(e)->point, Dest(e.Onext())->point);
-	insertMeshSite(dt, cc);
+	insertMeshSite(dt, dt.geometry(face).center);
 	return true;
 }
 
@@ -379,86 +404,144 @@ bool eliminate_bad_triangle(Subdivision& dt, double min_ratio, double min_area)
 {
 	auto face = find_bad(dt, min_ratio, min_area);
 	if (face == dt.faces.end()) return false;
-	auto e = face->bounds;
-	Point cc = circumCenter(Org(e)->point, Dest(e)->point, Dest(e.Onext())->point);
-	insertMeshSite(dt, cc);
+	insertMeshSite(dt, dt.geometry(face).center);
 	return true;
 }
 
 
 void eliminate_triangle(Subdivision& dt, FaceRef face)
 {
-	auto e = face->bounds;
-	Point cc = circumCenter(Org(e)->point, Dest(e)->point, Dest(e.Onext())->point);
-	insertMeshSite(dt, cc);
+	insertMeshSite(dt, dt.geometry(face).center);
 }
 
-std::tuple<FaceRef, double> find_worst(Subdivision & dt)
-{
-	FaceRef worst_face = dt.faces.end();
-	double max_ratio = -1.0;
+// FaceQueue
 
+FaceQueue::FaceQueue(Subdivision& dt) : dt(dt)
+{
 	for (auto face = dt.faces.begin(); face != dt.faces.end(); ++face)
-	{
-		if (!face->mark || face == dt.outer_face) continue;
-		auto e = face->bounds;
-		double ratio = quality_measure(Org(e)->point, Dest(e)->point, Dest(e.Onext())->point);
-		if (ratio > max_ratio) {
-			max_ratio = ratio;
-			worst_face = face;
-		}
-	}
-	return{worst_face,max_ratio};
+		push(face);
+	dt.changes = &changes;
 }
 
-std::tuple<FaceRef, double> find_biggest(Subdivision & dt)
+FaceQueue::~FaceQueue()
 {
-	FaceRef biggest_face = dt.faces.end();
-	double max_area = -1.0;
+	dt.changes = nullptr;
+}
 
-	for (auto face = dt.faces.begin(); face != dt.faces.end(); ++face)
-	{
-		if (!face->mark || face == dt.outer_face) continue;
-		auto e = face->bounds;
-		double area = triangleArea(Org(e)->point, Dest(e)->point, Dest(e.Onext())->point);
-		if (area > max_area) {
-			max_area = area;
-			biggest_face = face;
-		}
-	}
-	return{biggest_face,max_area};
+void FaceQueue::push(FaceRef face)
+{
+	if (!face->mark || face == dt.outer_face) return;
+	TriangleGeometry const& g = dt.geometry(face);
+	ratios.push_back({g.ratio2, face->serial, face->stamp, face});
+	std::push_heap(ratios.begin(), ratios.end());
+	areas.push_back({g.area, face->serial, face->stamp, face});
+	std::push_heap(areas.begin(), areas.end());
 }
 
-std::tuple<FaceRef, double> find_smallest(Subdivision & dt)
+void FaceQueue::update()
 {
-	FaceRef smallest_face = dt.faces.end();
-	double min_area = std::numeric_limits<double>::max();
+	// mostly stale entries: start over from the faces list
+	if (ratios.size() > 4 * dt.faces.size() + 1024) {
+		reset();
+		return;
+	}
+	// a face touched more than once is queued for its last stamp only
+	for (auto const& c : changes)
+		if (c.first->stamp == c.second)
+			push(c.first);
+	changes.clear();
+}
 
+void FaceQueue::reset()
+{
+	ratios.clear();
+	areas.clear();
+	changes.clear();
 	for (auto face = dt.faces.begin(); face != dt.faces.end(); ++face)
-	{
-		if (!face->mark || face == dt.outer_face) continue;
-		auto e = face->bounds;
-		double area = triangleArea(Org(e)->point, Dest(e)->point, Dest(e.Onext())->point);
-		if (area < min_area) {
-			min_area = area;
-			smallest_face = face;
-		}
+		push(face);
+}
+
+std::tuple<FaceRef, double> FaceQueue::top(std::vector<Entry>& heap)
+{
+	update();
+	while (!heap.empty()) {
+		Entry const& t = heap.front();
+		if (t.face->stamp == t.stamp)
+			return{t.face, t.key};
+		std::pop_heap(heap.begin(), heap.end());
+		heap.pop_back();
 	}
-	return{smallest_face,min_area};
+	return{dt.faces.end(), -1.0};
+}
+
+std::tuple<FaceRef, double> FaceQueue::worst()
+{
+	return top(ratios);
+}
+
+std::tuple<FaceRef, double> FaceQueue::biggest()
+{
+	return top(areas);
+}
+
+// The inner face whose key beats all others', the earliest one in the
+// faces list on ties, with its key; none if there are no inner faces.
+// Large meshes are scanned in parallel chunks (see reduce_faces).
+template <class Key, class Better>
+static std::tuple<FaceRef, double> find_extreme(Subdivision& dt, double none, Key key, Better better)
+{
+	using Best = std::tuple<FaceRef, double>;
+	return reduce_faces(dt, Best{dt.faces.end(), none},
+		[&](Best& best, FaceRef face) {
+			if (!face->mark || face == dt.outer_face) return;
+			double k = key(face);
+			if (better(k, std::get<1>(best)))
+				best = Best{face, k};
+		},
+		[&](Best& best, Best const& next) {
+			if (std::get<0>(next) != dt.faces.end() && better(std::get<1>(next), std::get<1>(best)))
+				best = next;
+		});
+}
+
+std::tuple<FaceRef, double> find_worst2(Subdivision & dt)
+{
+	return find_extreme(dt, -1.0, [&](FaceRef face) { return dt.geometry(face).ratio2; },
+		std::greater<double>());
+}
+
+std::tuple<FaceRef, double> find_worst(Subdivision & dt)
+{
+	FaceRef face; double ratio2;
+	std::tie(face, ratio2) = find_worst2(dt);
+	return{face, ratio2 < 0.0 ? ratio2 : sqrt(ratio2)};
+}
+
+std::tuple<FaceRef, double> find_biggest(Subdivision & dt)
+{
+	return find_extreme(dt, -1.0, [&](FaceRef face) { return dt.geometry(face).area; },
+		std::greater<double>());
+}
+
+std::tuple<FaceRef, double> find_smallest(Subdivision & dt)
+{
+	return find_extreme(dt, std::numeric_limits<double>::max(),
+		[&](FaceRef face) { return dt.geometry(face).area; }, std::less<double>());
 }
 
 FaceRef find_bad(Subdivision & dt, double min_ratio, double min_area)
 {
 	FaceRef bad_face = dt.faces.end();
+	double min_ratio2 = min_ratio * min_ratio;
 
 	for (auto face = dt.faces.begin(); face != dt.faces.end(); ++face)
 	{
 		if (!face->mark || face == dt.outer_face) continue;
-		auto e = face->bounds;
-		double ratio = quality_measure(Org(e)->point, Dest(e)->point, Dest(e.Onext())->point);
-		double area = triangleArea(Org(e)->point, Dest(e)->point, Dest(e.Onext())->point);
-		if (ratio > min_ratio) {
-			min_ratio = ratio;
+		TriangleGeometry const& g = dt.geometry(face);
+		double ratio2 = g.ratio2;
+		double area = g.area;
+		if (ratio2 > min_ratio2) {
+			min_ratio2 = ratio2;
 			bad_face = face;
 			break;
 		}
@@ -474,13 +557,13 @@ FaceRef find_bad(Subdivision & dt, double min_ratio, double min_area)
 FaceRef find_bad(Subdivision & dt, double max_ratio)
 {
 	FaceRef worst_face = dt.faces.end();
+	double max_ratio2 = max_ratio * max_ratio;
 
 	for (auto face = dt.faces.begin(); face != dt.faces.end(); ++face)
 	{
 		if (!face->mark || face == dt.outer_face) continue;
-		auto e = face->bounds;
-		double ratio = quality_measure(Org(e)->point, Dest(e)->point, Dest(e.Onext())->point);
-		if (ratio > max_ratio) {
+		double ratio2 = dt.geometry(face).ratio2;
+		if (ratio2 > max_ratio2) {
 			worst_face = face;
 			break;
 		}
@@ -488,22 +571,40 @@ FaceRef find_bad(Subdivision & dt, double max_ratio)
 	return worst_face;
 }
 
-void ruppert_refinement(Subdivision & dt, double min_ratio, int max_iters)
+void ruppert_refinement(Subdivision & dt, double min_ratio, int max_iters, Checkpoints* checkpoints)
 {
-	splitEdges(dt);
-	int iters = 0;
-	while (iters < max_iters && eliminate_worst_triangle(dt, min_ratio))
+	PredicateStats stats = predicateStats();
+	// a resumed run has split them already
+	if (!checkpoints || checkpoints->done() == 0)
+		splitEdges(dt);
+	FaceQueue queue(dt);
+	int iters = checkpoints ? checkpoints->done() : 0;
+	while (iters < max_iters && eliminate_worst_triangle(dt, min_ratio, &queue)) {
 		++iters;
+		if (checkpoints)
+			checkpoints->step(dt, iters);
+	}
 	std::cout << iters << '\n';
+	if (predicate_stats)
+		std::cout << predicateStats() - stats;
 }
 
-void ruppert_refinement(Subdivision & dt, double min_ratio, double min_area, int max_iters)
+void ruppert_refinement(Subdivision & dt, double min_ratio, double min_area, int max_iters, Checkpoints* checkpoints)
 {
-	splitEdges(dt);
-	int iters = 0;
-	while (iters < max_iters && eliminate_worst_triangle(dt, min_ratio, min_area))
+	PredicateStats stats = predicateStats();
+	// a resumed run has split them already
+	if (!checkpoints || checkpoints->done() == 0)
+		splitEdges(dt);
+	FaceQueue queue(dt);
+	int iters = checkpoints ? checkpoints->done() : 0;
+	while (iters < max_iters && eliminate_worst_triangle(dt, min_ratio, min_area, &queue)) {
 		++iters;
+		if (checkpoints)
+			checkpoints->step(dt, iters);
+	}
 	std::cout << iters << '\n';
+	if (predicate_stats)
+		std::cout << predicateStats() - stats;
 }
 
 void insertClosedLoop(Subdivision& dt, std::vector<Point> const & hole)
@@ -596,15 +697,72 @@ VertexRef insertSite_wf(Subdivision& s, Point x, EdgeRef e)
 	return X;
 }
 
-bool chew_2nd_eliminate_worst(Subdivision& dt, double min_ratio)
+// deleteEncroaching's buffers, reused by each thread's later calls
+struct FloodScratch {
+	std::vector<FaceRef> seen;
+	std::vector<EdgeRef> stack;
+	std::vector<VertexRef> found;
+};
+
+static thread_local FloodScratch floodScratch;
+
+// Deletes the circumcenter vertices in the diametral circle of segment
+// e, in the order of the vertices list. They are found by a flood from e
+// through the triangles whose edges cross the circle; it stays within the
+// circle, a few dozen faces, so the faces seen are looked up in a list.
+static void deleteEncroaching(Subdivision& dt, EdgeRef e)
 {
-	FaceRef face; double ratio;
+	Point a = Org(e)->point, b = Dest(e)->point;
+	Point c = (a + b) * 0.5;
+	// a little wide, the vertices are tested with encroaches()
+	double r2 = sqNorm(b - a) / 4.0 * (1 + 1e-9);
+
+	// the squared distance of c from edge g
+	auto distance2 = [c](EdgeRef g) {
+		Point p = Org(g)->point, q = Dest(g)->point;
+		Point d = q - p;
+		double t = d * d > 0 ? std::max(0.0, std::min(1.0, ((c - p) * d) / (d * d))) : 0.0;
+		return sqNorm(p + d * t - c);
+	};
+
+	auto& seen = floodScratch.seen;
+	auto& stack = floodScratch.stack;
+	auto& found = floodScratch.found;
+	seen.assign({Left(e), Right(e)});
+	stack.assign({e, e.Sym()});
+	found.clear();
+	while (!stack.empty())
+	{
+		EdgeRef g = stack.back(); stack.pop_back();
+		auto end = g;
+		do {
+			if (Org(g)->circumcenter && encroaches(e, Org(g)->point))
+				found.push_back(Org(g));
+			if (distance2(g) <= r2 && std::find(seen.begin(), seen.end(), Right(g)) == seen.end()) {
+				seen.push_back(Right(g));
+				stack.push_back(g.Sym());
+			}
+			g = g.Lnext();
+		} while (g != end);
+	}
+
+	std::sort(found.begin(), found.end(), [](VertexRef u, VertexRef v) {
+		return u->serial < v->serial;
+	});
+	found.erase(std::unique(found.begin(), found.end()), found.end());
+	for (VertexRef v : found)
+		deleteSite_wf(dt, v);
+}
+
+bool chew_2nd_eliminate_worst(Subdivision& dt, double min_ratio, FaceQueue* queue)
+{
+	FaceRef face; double ratio2;
 
-	std::tie(face, ratio) = find_worst(dt);
-	if (ratio <= min_ratio)
+	std::tie(face, ratio2) = find_worst(dt, queue);
+	if (ratio2 <= min_ratio * min_ratio)
 		return false;
 	auto e = face->bounds;
-	Point c = circumCenter(Org(e)->point, Dest(e)->point, Dest(e.Onext())->point);
+	Point c = dt.geometry(face).center;
 
 	bool found_edge{true};
 	do
@@ -633,19 +791,7 @@ bool chew_2nd_eliminate_worst(Subdivision& dt, double min_ratio)
 
 	// found encroached edge
 	// delete all encroaching vertices
-	bool all_done = false;
-	while (!all_done)
-	{
-		all_done = true;
-		for (auto v = dt.vertices.begin(); v != dt.vertices.end(); ++v)
-		{
-			if (v->circumcenter && encroaches(e, v->point)) {
-				deleteSite_wf(dt, v);
-				all_done = false;
-				break;
-			}
-		}
-	}
+	deleteEncroaching(dt, e);
 	// split e
 	if (e.data().boundary)
 		splitBoundaryEdge(dt, e);
@@ -655,21 +801,21 @@ bool chew_2nd_eliminate_worst(Subdivision& dt, double min_ratio)
 	return true;
 }
 
-bool chew_2nd_eliminate_worst(Subdivision& dt, double min_ratio, double min_area)
+bool chew_2nd_eliminate_worst(Subdivision& dt, double min_ratio, double min_area, FaceQueue* queue = nullptr)
 {
-	FaceRef face; double ratio;
+	FaceRef face; double ratio2;
 
-	std::tie(face, ratio) = find_worst(dt);
-	if (ratio <= min_ratio)
+	std::tie(face, ratio2) = find_worst(dt, queue);
+	if (ratio2 <= min_ratio * min_ratio)
 	{
 		double area;
-		std::tie(face, area) = find_biggest(dt);
+		std::tie(face, area) = find_biggest(dt, queue);
 		if (area <= min_area)
 			return false;
 	}
 	
 	auto e = face->bounds;
-	Point c = circumCenter(Org(e)->point, Dest(e)->point, Dest(e.Onext())->point);
+	Point c = dt.geometry(face).center;
 
 	bool found_edge{true};
 	do
@@ -697,19 +843,7 @@ bool chew_2nd_eliminate_worst(Subdivision& dt, double min_ratio, double min_area
 	}
 	// found encroached edge
 	// delete all encroaching vertices
-	bool all_done = false;
-	while (!all_done)
-	{
-		all_done = true;
-		for (auto v = dt.vertices.begin(); v != dt.vertices.end(); ++v)
-		{
-			if (v->circumcenter && encroaches(e, v->point)) {
-				deleteSite_wf(dt, v);
-				all_done = false;
-				break;
-			}
-		}
-	}
+	deleteEncroaching(dt, e);
 	// split e
 	if (e.data().boundary) {
 		splitBoundaryEdge(dt, e);
@@ -720,20 +854,30 @@ bool chew_2nd_eliminate_worst(Subdivision& dt, double min_ratio, double min_area
 	return true;
 }
 
-void chew_2nd_refinement(Subdivision& dt, double min_ratio, int iters)
+void chew_2nd_refinement(Subdivision& dt, double min_ratio, int iters, Checkpoints* checkpoints)
 {
-	int i = 0;
-	while (i++ < iters && chew_2nd_eliminate_worst(dt, min_ratio))
-		;
+	PredicateStats stats = predicateStats();
+	FaceQueue queue(dt);
+	int i = checkpoints ? checkpoints->done() : 0;
+	while (i++ < iters && chew_2nd_eliminate_worst(dt, min_ratio, &queue))
+		if (checkpoints)
+			checkpoints->step(dt, i);
 	std::cout << "iters: " << i << '\n';
+	if (predicate_stats)
+		std::cout << predicateStats() - stats;
 }
 
-void chew_2nd_refinement(Subdivision& dt, double min_ratio, double min_area, int iters)
+void chew_2nd_refinement(Subdivision& dt, double min_ratio, double min_area, int iters, Checkpoints* checkpoints)
 {
-	int i = 0;
-	while (i++ < iters && chew_2nd_eliminate_worst(dt, min_ratio, min_area))
-		;
+	PredicateStats stats = predicateStats();
+	FaceQueue queue(dt);
+	int i = checkpoints ? checkpoints->done() : 0;
+	while (i++ < iters && chew_2nd_eliminate_worst(dt, min_ratio, min_area, &queue))
+		if (checkpoints)
+			checkpoints->step(dt, i);
 	std::cout << "iters: " << i << '\n';
+	if (predicate_stats)
+		std::cout << predicateStats() - stats;
 }
 
 bool off_center_correction(Subdivision& dt, VertexRef v, double min_angle, double q)
@@ -755,7 +899,14 @@ bool off_center_correction(Subdivision& dt, VertexRef v, double min_angle, doubl
 			double t_P = (BA*BC) / (BC*BC);
 			Point BP = BC*t_P;
 			Point AP = BP - BA;
+			dt.locator.remove(v);
 			A = A + AP*q;
+			dt.locator.add(v);
+			auto f = v->leaves;
+			do {
+				dt.touch(Left(f));
+				f = f.Onext();
+			} while (f != v->leaves);
 			AB = B - A; AC = C - A;
 			std::cout << angle;
 			angle = acos(AB*AC / (norm(AB) * norm(AC))) * 180.0 / pi;
@@ -773,15 +924,15 @@ double ratio_to_angle(double ratio)
 	return asin(1.0 / (2.0*ratio)) / boost::math::double_constants::pi * 180.0;
 }
 
-bool chew_2nd_eliminate_worst_correction(Subdivision& dt, double min_ratio)
+bool chew_2nd_eliminate_worst_correction(Subdivision& dt, double min_ratio, FaceQueue* queue = nullptr)
 {
-	FaceRef face; double ratio;
+	FaceRef face; double ratio2;
 
-	std::tie(face, ratio) = find_worst(dt);
-	if (ratio <= min_ratio)
+	std::tie(face, ratio2) = find_worst(dt, queue);
+	if (ratio2 <= min_ratio * min_ratio)
 		return false;
 	auto e = face->bounds;
-	Point c = circumCenter(Org(e)->point, Dest(e)->point, Dest(e.Onext())->point);
+	Point c = dt.geometry(face).center;
 	//std::cout << "face " << Org(e)->point << ' ' << Dest(e)->point << ' ' << Dest(e.Onext())->point
 	//	<< '\n';
 
@@ -814,19 +965,7 @@ bool chew_2nd_eliminate_worst_correction(Subdivision& dt, double min_ratio)
 
 	// found encroached edge
 	// delete all encroaching vertices
-	bool all_done = false;
-	while (!all_done)
-	{
-		all_done = true;
-		for (auto v = dt.vertices.begin(); v != dt.vertices.end(); ++v)
-		{
-			if (v->circumcenter && encroaches(e, v->point)) {
-				deleteSite_wf(dt, v);
-				all_done = false;
-				break;
-			}
-		}
-	}
+	deleteEncroaching(dt, e);
 	// split e
 	if (e.data().boundary)
 		splitBoundaryEdge(dt, e);
@@ -837,21 +976,21 @@ bool chew_2nd_eliminate_worst_correction(Subdivision& dt, double min_ratio)
 }
 
 bool chew_2nd_eliminate_worst_correction(Subdivision& dt, double min_ratio,
-	double min_area, double q)
+	double min_area, double q, FaceQueue* queue = nullptr)
 {
-	FaceRef face; double ratio;
+	FaceRef face; double ratio2;
 
-	std::tie(face, ratio) = find_worst(dt);
-	if (ratio <= min_ratio)
+	std::tie(face, ratio2) = find_worst(dt, queue);
+	if (ratio2 <= min_ratio * min_ratio)
 	{
 		double area;
-		std::tie(face, area) = find_biggest(dt);
+		std::tie(face, area) = find_biggest(dt, queue);
 		if (area <= min_area)
 			return false;
 	}
 
 	auto e = face->bounds;
-	Point c = circumCenter(Org(e)->point, Dest(e)->point, Dest(e.Onext())->point);
+	Point c = dt.geometry(face).center;
 
 	bool found_edge{true};
 	do
@@ -881,19 +1020,7 @@ bool chew_2nd_eliminate_worst_correction(Subdivision& dt, double min_ratio,
 
 	// found encroached edge
 	// delete all encroaching vertices
-	bool all_done = false;
-	while (!all_done)
-	{
-		all_done = true;
-		for (auto v = dt.vertices.begin(); v != dt.vertices.end(); ++v)
-		{
-			if (v->circumcenter && encroaches(e, v->point)) {
-				deleteSite_wf(dt, v);
-				all_done = false;
-				break;
-			}
-		}
-	}
+	deleteEncroaching(dt, e);
 	// split e
 	if (e.data().boundary)
 		splitBoundaryEdge(dt, e);
@@ -903,20 +1030,30 @@ bool chew_2nd_eliminate_worst_correction(Subdivision& dt, double min_ratio,
 	return true;
 }
 
-void chew_2nd_refinement_alper(Subdivision& dt, double min_ratio, int iters)
+void chew_2nd_refinement_alper(Subdivision& dt, double min_ratio, int iters, Checkpoints* checkpoints)
 {
-	int i = 0;
-	while (i++ < iters && chew_2nd_eliminate_worst_correction(dt, min_ratio))
-		;
+	PredicateStats stats = predicateStats();
+	FaceQueue queue(dt);
+	int i = checkpoints ? checkpoints->done() : 0;
+	while (i++ < iters && chew_2nd_eliminate_worst_correction(dt, min_ratio, &queue))
+		if (checkpoints)
+			checkpoints->step(dt, i);
 	std::cout << "iters: " << i << '\n';
+	if (predicate_stats)
+		std::cout << predicateStats() - stats;
 }
 
-void chew_2nd_refinement_alper(Subdivision& dt, double q, double min_ratio, double min_area, int iters)
+void chew_2nd_refinement_alper(Subdivision& dt, double q, double min_ratio, double min_area, int iters, Checkpoints* checkpoints)
 {
-	int i = 0;
-	while (i++ < iters && chew_2nd_eliminate_worst_correction(dt, min_ratio, min_area, q))
-		;
+	PredicateStats stats = predicateStats();
+	FaceQueue queue(dt);
+	int i = checkpoints ? checkpoints->done() : 0;
+	while (i++ < iters && chew_2nd_eliminate_worst_correction(dt, min_ratio, min_area, q, &queue))
+		if (checkpoints)
+			checkpoints->step(dt, i);
 	std::cout << "iters: " << i << '\n';
+	if (predicate_stats)
+		std::cout << predicateStats() - stats;
 }
 
 
@@ -1,5 +1,9 @@
 #pragma once
 #include "Subdivision.h"
+#include <tuple>
+#include <vector>
+
+class Checkpoints;
 
 void init_faces(Subdivision&);
 void mark_outer_faces(Subdivision& s, EdgeRef outEdge);
@@ -15,38 +19,85 @@ bool inside(Subdivision& s, Point x);
 VertexRef insertMeshSite(Subdivision& s, Point x);
 void eliminate_triangle(Subdivision& dt, FaceRef face);
 
-bool eliminate_worst_triangle(Subdivision& dt, double min_ratio);
-bool eliminate_worst_triangle(Subdivision& dt, double min_ratio, double min_area);
+// Inner faces by squared radius-edge ratio and by area, in the order
+// find_worst2 and find_biggest would pick them, kept up to date from the faces the
+// subdivision touches while the queue lives. Entries of faces changed or
+// deleted since they were queued are dropped as they come up.
+class FaceQueue
+{
+public:
+	explicit FaceQueue(Subdivision& dt);
+	~FaceQueue();
+	FaceQueue(FaceQueue const&) = delete;
+	FaceQueue& operator=(FaceQueue const&) = delete;
+
+	std::tuple<FaceRef, double> worst();
+	std::tuple<FaceRef, double> biggest();
+private:
+	struct Entry {
+		double key;
+		std::uint64_t serial;
+		std::uint32_t stamp;
+		FaceRef face;
+		// heap order: greatest key, then earliest face
+		bool operator<(Entry const& o) const {
+			return key < o.key || (key == o.key && serial > o.serial);
+		}
+	};
+	void update();
+	// queues the faces afresh, leaving the queue as a new one would be
+	void reset();
+	void push(FaceRef f);
+	std::tuple<FaceRef, double> top(std::vector<Entry>& heap);
+
+	Subdivision& dt;
+	std::vector<std::pair<FaceRef, std::uint32_t>> changes;
+	std::vector<Entry> ratios;
+	std::vector<Entry> areas;
+};
+
+// with a queue, faces are picked from it rather than by scanning
+bool eliminate_worst_triangle(Subdivision& dt, double min_ratio, FaceQueue* queue = nullptr);
+bool eliminate_worst_triangle(Subdivision& dt, double min_ratio, double min_area, FaceQueue* queue = nullptr);
 
 bool eliminate_bad_triangle(Subdivision& dt, double min_ratio);
 bool eliminate_bad_triangle(Subdivision& dt, double min_ratio, double min_area);
 
 
 std::tuple<FaceRef, double> find_worst(Subdivision & dt);
+// the same with the squared ratio, saving the square root
+std::tuple<FaceRef, double> find_worst2(Subdivision & dt);
 std::tuple<FaceRef, double> find_biggest(Subdivision & dt);
 std::tuple<FaceRef, double> find_smallest(Subdivision & dt);
 
 FaceRef find_bad(Subdivision & dt, double ratio, double area);
 FaceRef find_bad(Subdivision & dt, double ratio);
 
-void ruppert_refinement(Subdivision & dt, double min_ratio, int max_iters=1000);
-void ruppert_refinement(Subdivision & dt, double min_ratio, double min_area, int max_iters=1000);
+// With checkpoints (see checkpoint.h) the refiners save their progress as
+// they go and, resumed from a checkpoint, carry on from it.
+void ruppert_refinement(Subdivision & dt, double min_ratio, int max_iters=1000,
+	Checkpoints* checkpoints = nullptr);
+void ruppert_refinement(Subdivision & dt, double min_ratio, double min_area, int max_iters=1000,
+	Checkpoints* checkpoints = nullptr);
 
 
 void insertClosedLoop(Subdivision & dt, std::vector<Point> const& hole);
 
 void deleteSite_wf(Subdivision& dt, VertexRef v);
 
-bool chew_2nd_eliminate_worst(Subdivision& dt, double min_ratio);
+bool chew_2nd_eliminate_worst(Subdivision& dt, double min_ratio, FaceQueue* queue = nullptr);
 
-void chew_2nd_refinement(Subdivision& dt, double min_ratio, int max_iters=1000);
-void chew_2nd_refinement(Subdivision& dt, double min_ratio, double min_area, int max_iters = 1000);
+void chew_2nd_refinement(Subdivision& dt, double min_ratio, int max_iters=1000,
+	Checkpoints* checkpoints = nullptr);
+void chew_2nd_refinement(Subdivision& dt, double min_ratio, double min_area, int max_iters = 1000,
+	Checkpoints* checkpoints = nullptr);
 
 bool off_center_correction(Subdivision& dt, VertexRef site, double min_angle, double q);
 
-void chew_2nd_refinement_alper(Subdivision& dt, double min_ratio, int iters=1000);
+void chew_2nd_refinement_alper(Subdivision& dt, double min_ratio, int iters=1000,
+	Checkpoints* checkpoints = nullptr);
 void chew_2nd_refinement_alper(Subdivision& dt, double q,
-	double min_ratio, double min_area, int iters = 1000);
+	double min_ratio, double min_area, int iters = 1000, Checkpoints* checkpoints = nullptr);
 
 double ratio_to_angle(double ratio);
 
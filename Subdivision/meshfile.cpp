@@ -0,0 +1,336 @@
+#include "meshfile.h"
+#include "mapped.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+static char const mesh_magic[8] = {'Q', 'E', 'M', 'E', 'S', 'H', '\r', '\n'};
+static std::uint32_t const mesh_version = 1;
+static std::uint32_t const none = ~std::uint32_t{0};
+// more than an arena holds
+static std::uint64_t const max_count = std::uint64_t{1} << 30;
+
+static bool little_endian()
+{
+	std::uint16_t one = 1;
+	unsigned char low;
+	std::memcpy(&low, &one, 1);
+	return low == 1;
+}
+
+// v between host and little-endian order (the same either way round)
+template <class T>
+static T little(T v)
+{
+	if (!little_endian()) {
+		unsigned char b[sizeof v];
+		std::memcpy(b, &v, sizeof v);
+		std::reverse(b, b + sizeof v);
+		std::memcpy(&v, b, sizeof v);
+	}
+	return v;
+}
+
+// element i of a little-endian array at p
+template <class T>
+static T get(char const* p, std::uint64_t i)
+{
+	T v;
+	std::memcpy(&v, p + i * sizeof v, sizeof v);
+	return little(v);
+}
+
+static std::uint64_t align8(std::uint64_t n)
+{
+	return (n + 7) & ~std::uint64_t{7};
+}
+
+// byte offsets of the sections (see meshfile.h) and the file size
+struct Layout {
+	std::uint64_t points, leaves, circumcenter, next, slot, flags, mark, bounds, size;
+};
+
+// the locator section, from the end of the others
+struct LocatorLayout {
+	std::uint64_t grid, samples, size;
+};
+
+static Layout layout(std::uint64_t vertices, std::uint64_t quad_edges, std::uint64_t faces)
+{
+	Layout l;
+	l.points = sizeof(MeshFileHeader);
+	l.leaves = l.points + 16 * vertices;
+	l.circumcenter = l.leaves + 4 * vertices;
+	l.next = align8(l.circumcenter + vertices);
+	l.slot = l.next + 16 * quad_edges;
+	l.flags = l.slot + 16 * quad_edges;
+	l.mark = align8(l.flags + 4 * quad_edges);
+	l.bounds = l.mark + 4 * faces;
+	l.size = align8(l.bounds + 4 * faces);
+	return l;
+}
+
+static LocatorLayout locator_layout(std::uint64_t start, std::uint64_t cells)
+{
+	LocatorLayout l;
+	l.grid = start;
+	l.samples = l.grid + 32;
+	l.size = align8(l.samples + 4 * cells);
+	return l;
+}
+
+// little-endian values to a stream, through a buffer
+class Sink
+{
+public:
+	explicit Sink(std::ostream& out) : out(out) {}
+	~Sink() { flush(); }
+
+	template <class T>
+	void put(T v)
+	{
+		v = little(v);
+		if (used + sizeof v > sizeof buffer)
+			flush();
+		std::memcpy(buffer + used, &v, sizeof v);
+		used += sizeof v;
+		written += sizeof v;
+	}
+	// zeros up to the next multiple of 8 bytes
+	void align()
+	{
+		while (written % 8)
+			put(std::uint8_t{0});
+	}
+	void flush()
+	{
+		out.write(buffer, used);
+		used = 0;
+	}
+private:
+	std::ostream& out;
+	std::uint64_t written{};
+	std::size_t used{};
+	char buffer[1 << 16];
+};
+
+static bool fail(char const* path, char const* what)
+{
+	std::cerr << path << ": " << what << '\n';
+	return false;
+}
+
+// the number of each element in list order, by arena index
+template <class It, class Index>
+static std::vector<std::uint32_t> numbering(It begin, It end, Index index)
+{
+	std::uint32_t top = 0;
+	for (It i = begin; i != end; ++i)
+		top = std::max(top, index(i) + 1);
+	std::vector<std::uint32_t> number(top, none);
+	std::uint32_t n = 0;
+	for (It i = begin; i != end; ++i)
+		number[index(i)] = n++;
+	return number;
+}
+
+bool save_mesh(char const* path, Subdivision& dt, std::uint64_t iterations)
+{
+	using QuadEdgeRef = Subdivision::Edges::QuadEdgeRef;
+	auto vertex_number = numbering(dt.vertices.begin(), dt.vertices.end(),
+		[](VertexRef v) { return v.index(); });
+	auto face_number = numbering(dt.faces.begin(), dt.faces.end(),
+		[](FaceRef f) { return f.index(); });
+	auto quad_number = numbering(dt.edges.begin(), dt.edges.end(),
+		[](QuadEdgeRef q) { return q.index(); });
+
+	auto vertex = [&](VertexRef v) {
+		return v == dt.vertices.end() ? none : vertex_number[v.index()];
+	};
+	auto face = [&](FaceRef f) {
+		return f == dt.faces.end() ? none : face_number[f.index()];
+	};
+	auto edge = [&](EdgeRef e) {
+		return e ? quad_number[e.quadEdgeRef().index()] << 2 | std::uint32_t(e.rotation()) : none;
+	};
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+		return fail(path, "cannot create the file");
+	{
+		std::unique_ptr<Sink> sink(new Sink(file));
+		Sink& out = *sink;
+
+		for (char c : mesh_magic)
+			out.put(c);
+		out.put(mesh_version);
+		out.put(std::uint32_t(sizeof(MeshFileHeader)));
+		out.put(std::uint64_t(dt.vertices.size()));
+		out.put(std::uint64_t(dt.edges.size()));
+		out.put(std::uint64_t(dt.faces.size()));
+		out.put(face(dt.outer_face));
+		out.put(std::uint32_t(dt.locator.built()));
+		out.put(iterations);
+		for (int i = 0; i < 2; ++i)
+			out.put(std::uint32_t{0});
+
+		for (auto v = dt.vertices.begin(); v != dt.vertices.end(); ++v) {
+			out.put(v->point.x);
+			out.put(v->point.y);
+		}
+		for (auto v = dt.vertices.begin(); v != dt.vertices.end(); ++v)
+			out.put(edge(v->leaves));
+		for (auto v = dt.vertices.begin(); v != dt.vertices.end(); ++v)
+			out.put(std::uint8_t(v->circumcenter));
+		out.align();
+
+		for (auto q = dt.edges.begin(); q != dt.edges.end(); ++q)
+			for (int r = 0; r < 4; ++r)
+				out.put(edge(EdgeRef(q, r).Onext()));
+		for (auto q = dt.edges.begin(); q != dt.edges.end(); ++q)
+			for (int r = 0; r < 4; ++r) {
+				auto const& d = EdgeRef(q, r).data();
+				out.put(r % 2 == 0 ? vertex(d.slot.vertex) : face(d.slot.face));
+			}
+		for (auto q = dt.edges.begin(); q != dt.edges.end(); ++q)
+			for (int r = 0; r < 4; ++r) {
+				auto const& d = EdgeRef(q, r).data();
+				out.put(std::uint8_t(d.fixed | d.boundary << 1));
+			}
+		out.align();
+
+		for (auto f = dt.faces.begin(); f != dt.faces.end(); ++f)
+			out.put(std::int32_t(f->mark));
+		for (auto f = dt.faces.begin(); f != dt.faces.end(); ++f)
+			out.put(edge(f->bounds));
+		out.align();
+
+		if (dt.locator.built()) {
+			auto const& loc = dt.locator;
+			out.put(loc.origin.x);
+			out.put(loc.origin.y);
+			out.put(loc.cell);
+			out.put(std::uint32_t(loc.nx));
+			out.put(std::uint32_t(loc.ny));
+			for (VertexRef v : loc.samples)
+				out.put(vertex(v));
+			out.align();
+		}
+	}
+	if (!file.flush())
+		return fail(path, "write error");
+	return true;
+}
+
+bool load_mesh(char const* path, Subdivision& out, std::uint64_t* iterations)
+{
+	using QuadEdgeRef = Subdivision::Edges::QuadEdgeRef;
+	MappedFile file(path);
+	if (!file.is_open())
+		return fail(path, "cannot open the file");
+	char const* base = file.data();
+	if (file.size() < sizeof(MeshFileHeader) || std::memcmp(base, mesh_magic, sizeof mesh_magic) != 0)
+		return fail(path, "not a mesh file");
+	if (get<std::uint32_t>(base + 8, 0) != mesh_version)
+		return fail(path, "unsupported mesh file version");
+	if (get<std::uint32_t>(base + 12, 0) != sizeof(MeshFileHeader))
+		return fail(path, "bad header size");
+	std::uint64_t nv = get<std::uint64_t>(base + 16, 0);
+	std::uint64_t ne = get<std::uint64_t>(base + 24, 0);
+	std::uint64_t nf = get<std::uint64_t>(base + 32, 0);
+	std::uint32_t outer = get<std::uint32_t>(base + 40, 0);
+	if (nv > max_count || ne > max_count || nf > max_count)
+		return fail(path, "too many elements");
+	Layout l = layout(nv, ne, nf);
+	if (file.size() < l.size)
+		return fail(path, "truncated mesh file");
+
+	Subdivision dt;
+	std::vector<VertexRef> vertices(nv);
+	for (std::uint64_t i = 0; i < nv; ++i) {
+		VertexRef v = vertices[i] = dt.vertices.add();
+		v->point = Point{get<double>(base + l.points, 2 * i), get<double>(base + l.points, 2 * i + 1)};
+		v->circumcenter = get<std::uint8_t>(base + l.circumcenter, i) != 0;
+	}
+	std::vector<std::uint32_t> quads(ne);
+	for (std::uint64_t i = 0; i < ne; ++i)
+		quads[i] = dt.edges.makeEdge().quadEdgeRef().index();
+	std::vector<FaceRef> faces(nf);
+	for (std::uint64_t i = 0; i < nf; ++i) {
+		FaceRef f = faces[i] = dt.faces.add();
+		f->mark = get<std::int32_t>(base + l.mark, i);
+	}
+
+	bool ok = true;
+	auto vertex = [&](std::uint32_t i) {
+		if (i == none) return VertexRef{};
+		if (i >= nv) { ok = false; return VertexRef{}; }
+		return vertices[i];
+	};
+	auto face = [&](std::uint32_t i) {
+		if (i == none) return FaceRef{};
+		if (i >= nf) { ok = false; return FaceRef{}; }
+		return faces[i];
+	};
+	auto edge = [&](std::uint32_t i) {
+		if (i == none) return EdgeRef{};
+		if ((i >> 2) >= ne) { ok = false; return EdgeRef{}; }
+		return EdgeRef(QuadEdgeRef(quads[i >> 2]), int(i & 3));
+	};
+
+	for (std::uint64_t q = 0; q < ne; ++q)
+		for (int r = 0; r < 4; ++r) {
+			EdgeRef e(QuadEdgeRef(quads[q]), r);
+			std::uint64_t i = 4 * q + r;
+			Subdivision::Edges::setOnext(e, edge(get<std::uint32_t>(base + l.next, i)));
+			auto& d = e.data();
+			std::uint32_t slot = get<std::uint32_t>(base + l.slot, i);
+			if (r % 2 == 0)
+				d.slot.vertex = vertex(slot);
+			else
+				d.slot.face = face(slot);
+			std::uint8_t flags = get<std::uint8_t>(base + l.flags, i);
+			d.fixed = (flags & 1) != 0;
+			d.boundary = (flags & 2) != 0;
+		}
+	for (std::uint64_t i = 0; i < nv; ++i)
+		vertices[i]->leaves = edge(get<std::uint32_t>(base + l.leaves, i));
+	for (std::uint64_t i = 0; i < nf; ++i)
+		faces[i]->bounds = edge(get<std::uint32_t>(base + l.bounds, i));
+	dt.outer_face = face(outer);
+	if (!ok)
+		return fail(path, "index out of range");
+
+	if (get<std::uint32_t>(base + 44, 0) == 1) {
+		if (file.size() < l.size + 32)
+			return fail(path, "truncated mesh file");
+		std::uint32_t nx = get<std::uint32_t>(base + l.size + 24, 0);
+		std::uint32_t ny = get<std::uint32_t>(base + l.size + 28, 0);
+		// as Locator::build makes them
+		if (nx < 1 || ny < 1 || nx > 1u << 15 || ny > 1u << 15)
+			return fail(path, "bad locator grid");
+		std::uint64_t cells = std::uint64_t(nx) * ny;
+		LocatorLayout g = locator_layout(l.size, cells);
+		if (file.size() < g.size)
+			return fail(path, "truncated mesh file");
+
+		auto& loc = dt.locator;
+		loc.origin = Point{get<double>(base + g.grid, 0), get<double>(base + g.grid, 1)};
+		loc.cell = get<double>(base + g.grid, 2);
+		loc.nx = int(nx);
+		loc.ny = int(ny);
+		loc.samples.resize(cells);
+		for (std::uint64_t i = 0; i < cells; ++i)
+			loc.samples[i] = vertex(get<std::uint32_t>(base + g.samples, i));
+		if (!ok || !(loc.cell > 0))
+			return fail(path, "bad locator grid");
+	}
+
+	out = std::move(dt);
+	if (iterations)
+		*iterations = get<std::uint64_t>(base + 48, 0);
+	return true;
+}
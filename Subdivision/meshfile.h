@@ -0,0 +1,43 @@
+#pragma once
+#include "Subdivision.h"
+
+// Binary mesh files: a subdivision as flat little-endian arrays, loaded
+// by mapping the file and copying the arrays into fresh arena slots.
+//
+// A 64-byte header (MeshFileHeader) is followed by these sections, each
+// starting at a multiple of 8 bytes. Vertices, quad-edges and faces are
+// numbered in list order; an edge is stored as quad-edge << 2 | rotation,
+// and ~0 stands for none.
+//   double   points[2 * vertices]      x, y
+//   uint32   leaves[vertices]          edge
+//   uint8    circumcenter[vertices]
+//   uint32   next[4 * quad_edges]      Onext of each record
+//   uint32   slot[4 * quad_edges]      origin vertex (even records) or
+//                                      face (odd records)
+//   uint8    flags[4 * quad_edges]     1 - fixed, 2 - boundary
+//   int32    mark[faces]
+//   uint32   bounds[faces]             edge
+// and, if the header's locator is 1, the subdivision's locator grid:
+//   double   origin[2], cell
+//   uint32   nx, ny
+//   uint32   samples[nx * ny]          vertex
+struct MeshFileHeader {
+	char magic[8]; // "QEMESH\r\n"
+	std::uint32_t version;
+	std::uint32_t header_size;
+	std::uint64_t vertices;
+	std::uint64_t quad_edges;
+	std::uint64_t faces;
+	std::uint32_t outer_face;
+	std::uint32_t locator; // 1 if the locator section is there
+	std::uint64_t iterations; // refinement steps done (see checkpoint.h)
+	std::uint32_t reserved[2];
+};
+static_assert(sizeof(MeshFileHeader) == 64, "mesh file header is 64 bytes");
+
+// Both print what went wrong to std::cerr and return false on failure;
+// load_mesh leaves 'dt' alone then. 'iterations' is kept in the header.
+// A built locator is saved along, so a loaded subdivision starts its point
+// location walks where the saved one would have.
+bool save_mesh(char const* path, Subdivision& dt, std::uint64_t iterations = 0);
+bool load_mesh(char const* path, Subdivision& dt, std::uint64_t* iterations = nullptr);
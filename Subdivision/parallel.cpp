@@ -0,0 +1,34 @@
+#include "parallel.h"
+#include <algorithm>
+#include <future>
+
+std::vector<FaceRef> face_handles(Subdivision const& dt)
+{
+	std::vector<FaceRef> faces;
+	faces.reserve(dt.faces.size());
+	for (auto face = dt.faces.begin(); face != dt.faces.end(); ++face)
+		faces.push_back(face);
+	return faces;
+}
+
+void run_chunks(std::size_t n, std::size_t chunks,
+	std::function<void(std::size_t, std::size_t, std::size_t)> const& body)
+{
+	auto bound = [=](std::size_t k) { return n / chunks * k + std::min(k, n % chunks); };
+
+	std::vector<std::future<void>> tasks;
+	for (std::size_t k = 1; k < chunks; ++k)
+		tasks.push_back(std::async(std::launch::async, [&body, bound, k] {
+			body(bound(k), bound(k + 1), k);
+		}));
+	if (chunks > 0)
+		body(bound(0), bound(1), 0);
+	for (auto& task : tasks)
+		task.get();
+}
+
+std::size_t chunk_count(std::size_t n, unsigned threads, std::size_t cutoff)
+{
+	std::size_t chunks = n / std::max<std::size_t>(cutoff, 1);
+	return std::max<std::size_t>(1, std::min<std::size_t>(chunks, std::max(threads, 1u)));
+}
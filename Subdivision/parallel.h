@@ -0,0 +1,50 @@
+#pragma once
+#include "Subdivision.h"
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// the faces of dt in list order
+std::vector<FaceRef> face_handles(Subdivision const& dt);
+
+// Splits [0, n) into 'chunks' contiguous ranges of about the same size and
+// calls body(begin, end, chunk) for each, chunks 1.. on asynchronous tasks
+// and chunk 0 on the calling thread; returns when all are done.
+void run_chunks(std::size_t n, std::size_t chunks,
+	std::function<void(std::size_t, std::size_t, std::size_t)> const& body);
+
+// how many chunks to split n items into: up to one per thread, none
+// shorter than 'cutoff'
+std::size_t chunk_count(std::size_t n, unsigned threads, std::size_t cutoff);
+
+// Reduction over the faces of dt: accumulate(T&, FaceRef) folds a face into
+// the value of its chunk, combine(T&, T const&) appends the value of the
+// next chunk. Chunks are contiguous runs of the faces list and are combined
+// in list order, so the result is the one a single pass down the list
+// gives. Faces lists shorter than 'cutoff' are walked serially, without
+// taking handles. The subdivision must not change meanwhile; accumulate
+// may fill the face's geometry cache (Subdivision::geometry), which only
+// writes to the face itself.
+template <class T, class Accumulate, class Combine>
+T reduce_faces(Subdivision& dt, T const& init, Accumulate accumulate, Combine combine,
+	unsigned threads = std::thread::hardware_concurrency(), std::size_t cutoff = 1 << 16)
+{
+	std::size_t chunks = chunk_count(dt.faces.size(), threads, cutoff);
+	if (chunks < 2) {
+		T value = init;
+		for (auto face = dt.faces.begin(); face != dt.faces.end(); ++face)
+			accumulate(value, face);
+		return value;
+	}
+
+	std::vector<FaceRef> faces = face_handles(dt);
+	std::vector<T> values(chunks, init);
+	run_chunks(faces.size(), chunks, [&](std::size_t b, std::size_t e, std::size_t k) {
+		for (std::size_t i = b; i < e; ++i)
+			accumulate(values[k], faces[i]);
+	});
+	for (std::size_t k = 1; k < chunks; ++k)
+		combine(values[0], values[k]);
+	return values[0];
+}
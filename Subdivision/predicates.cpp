@@ -1,5 +1,53 @@
 #include "predicates.h"
 #include "Point.h"
+#include "adapt.h"
+#include <algorithm>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#ifdef PREDICATE_STATS
+thread_local PredicateCounts predicateCounts;
+
+// the counts of the live threads, and what the exited ones left
+struct CountsRegistry {
+	std::mutex mutex;
+	std::vector<PredicateCounts*> live;
+	PredicateStats exited{};
+};
+
+static CountsRegistry& registry()
+{
+	static CountsRegistry r;
+	return r;
+}
+
+static PredicateStats::Stages stages(unsigned long long const* counts)
+{
+	return {counts[stage_fast], counts[stage_b], counts[stage_c], counts[stage_exact]};
+}
+
+static void add(PredicateStats::Stages& to, PredicateStats::Stages const& s)
+{
+	to.fast += s.fast; to.b += s.b; to.c += s.c; to.exact += s.exact;
+}
+
+PredicateCounts::PredicateCounts() : orient2dStages{}, incircleStages{}
+{
+	CountsRegistry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	r.live.push_back(this);
+}
+
+PredicateCounts::~PredicateCounts()
+{
+	CountsRegistry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	add(r.exited.orient2d, stages(orient2dStages));
+	add(r.exited.incircle, stages(incircleStages));
+	r.live.erase(std::find(r.live.begin(), r.live.end(), this));
+}
+#endif
 
 double orient2d(Point const& a, Point const& b, Point const& c) {
 	return orient2d((double*)&a, (double*)&b, (double*)&c);
@@ -7,4 +55,62 @@ double orient2d(Point const& a, Point const& b, Point const& c) {
 
 double incircle(Point const& a, Point const& b, Point const& c, Point const& d) {
 	return incircle((double*)&a, (double*)&b, (double*)&c, (double*)&d);
+}
+
+bool incircleAny(Point const& a, Point const& b, Point const& c,
+	Point const* const d[], std::size_t n)
+{
+	for (std::size_t i = 0; i < n; ++i)
+		if (incircle(a, b, c, *d[i]) > 0.0)
+			return true;
+	return false;
+}
+
+PredicateStats predicateStats()
+{
+#ifdef PREDICATE_STATS
+	// this thread's counts are listed from its first predicate call on
+	(void)predicateCounts;
+	CountsRegistry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	PredicateStats sum = r.exited;
+	for (PredicateCounts const* c : r.live) {
+		add(sum.orient2d, stages(c->orient2dStages));
+		add(sum.incircle, stages(c->incircleStages));
+	}
+	return sum;
+#else
+	return {};
+#endif
+}
+
+void resetPredicateStats()
+{
+#ifdef PREDICATE_STATS
+	CountsRegistry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	r.exited = PredicateStats{};
+	for (PredicateCounts* c : r.live) {
+		std::fill(c->orient2dStages, c->orient2dStages + stage_count, 0);
+		std::fill(c->incircleStages, c->incircleStages + stage_count, 0);
+	}
+#endif
+}
+
+PredicateStats operator-(PredicateStats const& a, PredicateStats const& b)
+{
+	auto sub = [](PredicateStats::Stages const& x, PredicateStats::Stages const& y) {
+		return PredicateStats::Stages{x.fast - y.fast, x.b - y.b, x.c - y.c, x.exact - y.exact};
+	};
+	return {sub(a.orient2d, b.orient2d), sub(a.incircle, b.incircle)};
+}
+
+static std::ostream& operator<<(std::ostream& os, PredicateStats::Stages const& s)
+{
+	return os << "fast " << s.fast << ", B " << s.b << ", C " << s.c << ", exact " << s.exact;
+}
+
+std::ostream& operator<<(std::ostream& os, PredicateStats const& s)
+{
+	return os << "orient2d: " << s.orient2d << '\n' << "incircle: " << s.incircle << '\n';
 }
\ No newline at end of file
@@ -1,10 +1,44 @@
 #pragma once
 #include "Point.h"
 
-// from robust predicates lib
-void exactinit();
+// from robust predicates lib; the constants are compile-time (adapt.h),
+// so they are safe to use from any thread without initialization
+void exactinit(); // does nothing, kept for old callers
 double orient2d(double* pa, double* pb, double* pc);
 double incircle(double* pa, double* pb, double* pc, double* pd);
 
 double orient2d(Point const& a, Point const& b, Point const& c);
-double incircle(Point const& a, Point const& b, Point const& c, Point const& d);
\ No newline at end of file
+double incircle(Point const& a, Point const& b, Point const& c, Point const& d);
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+// whether any of d[0..n) lies inside the circle through a, b and c
+bool incircleAny(Point const& a, Point const& b, Point const& c,
+	Point const* const d[], std::size_t n);
+
+// Calls of orient2d and incircle by the stage that settled them: the floating-point filter, stage B (or exactly
+// representable differences), the stage C correction, or the exact
+// expansion. Summed over all threads, the workers of reduce_faces and
+// delaunay_dnc_parallel included; read them while no other thread is
+// calling the predicates, e.g. between parallel runs. Counted only in
+// builds with PREDICATE_STATS defined, which predicate_stats tells;
+// otherwise they stay zero.
+#ifdef PREDICATE_STATS
+constexpr bool predicate_stats = true;
+#else
+constexpr bool predicate_stats = false;
+#endif
+
+struct PredicateStats {
+	struct Stages {
+		std::uint64_t fast, b, c, exact;
+	};
+	Stages orient2d, incircle;
+};
+
+PredicateStats predicateStats();
+void resetPredicateStats();
+// the calls made between two readings
+PredicateStats operator-(PredicateStats const& a, PredicateStats const& b);
+std::ostream& operator<<(std::ostream& os, PredicateStats const& s);
\ No newline at end of file
@@ -0,0 +1,251 @@
+#include "stats.h"
+#include "Point.h"
+#include "parallel.h"
+#include "boost/math/constants/constants.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <memory>
+#include <ostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define STATS_SSE2
+#endif
+
+Histogram::Histogram(double start, double end, double width)
+	: start{start}, width{width},
+	counts(std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil((end - start) / width))))
+{
+}
+
+void Histogram::add(double x)
+{
+	double k = std::floor((x - start) / width);
+	if (!(k > 0.0))
+		++counts.front();
+	else if (k >= counts.size())
+		++counts.back();
+	else
+		++counts[static_cast<std::size_t>(k)];
+}
+
+Histogram& Histogram::operator+=(Histogram const& other)
+{
+	assert(start == other.start && width == other.width && counts.size() == other.counts.size());
+	for (std::size_t i = 0; i < counts.size(); ++i)
+		counts[i] += other.counts[i];
+	return *this;
+}
+
+std::ostream& operator<<(std::ostream& os, Histogram const& h)
+{
+	for (std::size_t i = 0; i < h.counts.size(); ++i)
+		os << h.start + i * h.width << ' ' << h.counts[i] << '\n';
+	return os;
+}
+
+MeshStats::MeshStats(double bin)
+	: min_angles(0.0, 60.0, bin), max_angles(60.0, 180.0, bin)
+{
+}
+
+namespace {
+
+constexpr std::size_t block_size = 256;
+
+// Triangles gathered from the faces list, coordinates by vertex, and what
+// the kernel computes for them: the squared radius-edge ratio, the area
+// and the cosines of the smallest and largest angles.
+struct Block {
+	double ax[block_size], ay[block_size];
+	double bx[block_size], by[block_size];
+	double cx[block_size], cy[block_size];
+	double ratio2[block_size], area[block_size];
+	double cos_min[block_size], cos_max[block_size];
+	FaceRef face[block_size];
+};
+
+}
+
+// With squared sides lo <= mid <= hi: R^2 = lo mid hi / (4 cross^2), so
+// the squared ratio R^2 / lo needs no square root; the smallest angle is
+// opposite lo and the largest opposite hi (law of cosines).
+static void measure(Block& b, std::size_t i)
+{
+	double ux = b.bx[i] - b.ax[i], uy = b.by[i] - b.ay[i];
+	double vx = b.cx[i] - b.ax[i], vy = b.cy[i] - b.ay[i];
+	double wx = b.cx[i] - b.bx[i], wy = b.cy[i] - b.by[i];
+	double lc = ux * ux + uy * uy;
+	double lb = vx * vx + vy * vy;
+	double la = wx * wx + wy * wy;
+	double cross = ux * vy - uy * vx;
+
+	double lo = std::min(std::min(la, lb), lc);
+	double hi = std::max(std::max(la, lb), lc);
+	double mid = std::max(std::min(la, lb), std::min(std::max(la, lb), lc));
+
+	b.ratio2[i] = mid * hi / (4.0 * (cross * cross));
+	b.area[i] = std::abs(cross) * 0.5;
+	b.cos_min[i] = (mid + hi - lo) / (2.0 * std::sqrt(mid * hi));
+	b.cos_max[i] = (lo + mid - hi) / (2.0 * std::sqrt(lo * mid));
+}
+
+#ifdef STATS_SSE2
+
+// measure for triangles i and i + 1
+static void measure2(Block& b, std::size_t i)
+{
+	__m128d ax = _mm_loadu_pd(b.ax + i), ay = _mm_loadu_pd(b.ay + i);
+	__m128d bx = _mm_loadu_pd(b.bx + i), by = _mm_loadu_pd(b.by + i);
+	__m128d cx = _mm_loadu_pd(b.cx + i), cy = _mm_loadu_pd(b.cy + i);
+
+	__m128d ux = _mm_sub_pd(bx, ax), uy = _mm_sub_pd(by, ay);
+	__m128d vx = _mm_sub_pd(cx, ax), vy = _mm_sub_pd(cy, ay);
+	__m128d wx = _mm_sub_pd(cx, bx), wy = _mm_sub_pd(cy, by);
+	__m128d lc = _mm_add_pd(_mm_mul_pd(ux, ux), _mm_mul_pd(uy, uy));
+	__m128d lb = _mm_add_pd(_mm_mul_pd(vx, vx), _mm_mul_pd(vy, vy));
+	__m128d la = _mm_add_pd(_mm_mul_pd(wx, wx), _mm_mul_pd(wy, wy));
+	__m128d cross = _mm_sub_pd(_mm_mul_pd(ux, vy), _mm_mul_pd(uy, vx));
+
+	__m128d lo = _mm_min_pd(_mm_min_pd(la, lb), lc);
+	__m128d hi = _mm_max_pd(_mm_max_pd(la, lb), lc);
+	__m128d mid = _mm_max_pd(_mm_min_pd(la, lb), _mm_min_pd(_mm_max_pd(la, lb), lc));
+
+	__m128d two = _mm_set1_pd(2.0);
+	_mm_storeu_pd(b.ratio2 + i, _mm_div_pd(_mm_mul_pd(mid, hi),
+		_mm_mul_pd(_mm_set1_pd(4.0), _mm_mul_pd(cross, cross))));
+	_mm_storeu_pd(b.area + i, _mm_mul_pd(_mm_andnot_pd(_mm_set1_pd(-0.0), cross), _mm_set1_pd(0.5)));
+	_mm_storeu_pd(b.cos_min + i, _mm_div_pd(_mm_sub_pd(_mm_add_pd(mid, hi), lo),
+		_mm_mul_pd(two, _mm_sqrt_pd(_mm_mul_pd(mid, hi)))));
+	_mm_storeu_pd(b.cos_max + i, _mm_div_pd(_mm_sub_pd(_mm_add_pd(lo, mid), hi),
+		_mm_mul_pd(two, _mm_sqrt_pd(_mm_mul_pd(lo, mid)))));
+}
+
+#endif
+
+static double angle(double cosine)
+{
+	using boost::math::double_constants::radian;
+	return std::acos(std::max(-1.0, std::min(1.0, cosine))) * radian;
+}
+
+static void flush(Block& b, std::size_t n, MeshStats& s, double& max_ratio2)
+{
+	std::size_t i = 0;
+#ifdef STATS_SSE2
+	for (; i + 2 <= n; i += 2)
+		measure2(b, i);
+#endif
+	for (; i < n; ++i)
+		measure(b, i);
+
+	for (i = 0; i < n; ++i) {
+		if (b.ratio2[i] > max_ratio2) {
+			max_ratio2 = b.ratio2[i];
+			s.worst = b.face[i];
+		}
+		if (b.area[i] > s.max_area) {
+			s.max_area = b.area[i];
+			s.biggest = b.face[i];
+		}
+		if (b.area[i] < s.min_area) {
+			s.min_area = b.area[i];
+			s.smallest = b.face[i];
+		}
+		double lo = angle(b.cos_min[i]), hi = angle(b.cos_max[i]);
+		s.min_angle = std::min(s.min_angle, lo);
+		s.max_angle = std::max(s.max_angle, hi);
+		s.min_angles.add(lo);
+		s.max_angles.add(hi);
+	}
+	s.triangles += n;
+}
+
+namespace {
+
+// what one thread of a mesh_stats pass gathers
+struct Pass {
+	Block b;
+	std::size_t n{};
+	double max_ratio2{-1.0};
+	MeshStats s;
+
+	explicit Pass(double bin) : s(bin) {}
+
+	void add(Subdivision& dt, FaceRef face)
+	{
+		if (!face->mark || face == dt.outer_face) return;
+		auto e = face->bounds;
+		Point const& p = Org(e)->point;
+		Point const& q = Dest(e)->point;
+		Point const& r = Dest(e.Onext())->point;
+		b.ax[n] = p.x; b.ay[n] = p.y;
+		b.bx[n] = q.x; b.by[n] = q.y;
+		b.cx[n] = r.x; b.cy[n] = r.y;
+		b.face[n] = face;
+		if (++n == block_size)
+			finish();
+	}
+
+	void finish()
+	{
+		flush(b, n, s, max_ratio2);
+		n = 0;
+	}
+
+	// appends the pass over the next run of faces; ties go to this one
+	void combine(Pass const& next)
+	{
+		if (next.max_ratio2 > max_ratio2) {
+			max_ratio2 = next.max_ratio2;
+			s.worst = next.s.worst;
+		}
+		if (next.s.max_area > s.max_area) {
+			s.max_area = next.s.max_area;
+			s.biggest = next.s.biggest;
+		}
+		if (next.s.min_area < s.min_area) {
+			s.min_area = next.s.min_area;
+			s.smallest = next.s.smallest;
+		}
+		s.min_angle = std::min(s.min_angle, next.s.min_angle);
+		s.max_angle = std::max(s.max_angle, next.s.max_angle);
+		s.min_angles += next.s.min_angles;
+		s.max_angles += next.s.max_angles;
+		s.triangles += next.s.triangles;
+	}
+};
+
+}
+
+MeshStats mesh_stats(Subdivision& dt, double bin, unsigned threads)
+{
+	std::size_t chunks = chunk_count(dt.faces.size(), threads, 1 << 16);
+	// blocks are too big for the stack of every thread
+	std::vector<std::unique_ptr<Pass>> passes;
+	for (std::size_t k = 0; k < chunks; ++k)
+		passes.emplace_back(new Pass(bin));
+
+	if (chunks < 2) {
+		for (auto face = dt.faces.begin(); face != dt.faces.end(); ++face)
+			passes[0]->add(dt, face);
+	}
+	else {
+		std::vector<FaceRef> faces = face_handles(dt);
+		run_chunks(faces.size(), chunks, [&](std::size_t b, std::size_t e, std::size_t k) {
+			for (std::size_t i = b; i < e; ++i)
+				passes[k]->add(dt, faces[i]);
+		});
+	}
+
+	Pass& pass = *passes[0];
+	pass.finish();
+	for (std::size_t k = 1; k < chunks; ++k) {
+		passes[k]->finish();
+		pass.combine(*passes[k]);
+	}
+	if (pass.max_ratio2 >= 0.0)
+		pass.s.max_ratio = std::sqrt(pass.max_ratio2);
+	return pass.s;
+}
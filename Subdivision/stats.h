@@ -0,0 +1,42 @@
+#pragma once
+#include "Subdivision.h"
+#include <cstddef>
+#include <iosfwd>
+#include <limits>
+#include <thread>
+#include <vector>
+
+// counts of values in bins of 'width' starting from 'start'; values past
+// either end go to the first or last bin
+struct Histogram {
+	double start;
+	double width;
+	std::vector<std::size_t> counts;
+
+	Histogram(double start, double end, double width);
+	void add(double x);
+	// adds the counts of a histogram with the same bins
+	Histogram& operator+=(Histogram const& other);
+};
+
+// one "bin count" line per bin, as plot.dat has them
+std::ostream& operator<<(std::ostream& os, Histogram const& h);
+
+// Quality of the inner triangles of a mesh (marked faces other than the
+// outer one), gathered in one pass. Angles are in degrees.
+struct MeshStats {
+	std::size_t triangles{};
+	double max_ratio{-1.0};
+	double min_area{std::numeric_limits<double>::max()}, max_area{-1.0};
+	double min_angle{180.0}, max_angle{0.0};
+	FaceRef worst, biggest, smallest;
+	// of each triangle's smallest angle (0 to 60) and largest (60 to 180)
+	Histogram min_angles, max_angles;
+
+	explicit MeshStats(double bin);
+};
+
+// large meshes are measured on up to 'threads' threads (see reduce_faces),
+// with the same result
+MeshStats mesh_stats(Subdivision& dt, double bin = 1.0,
+	unsigned threads = std::thread::hardware_concurrency());
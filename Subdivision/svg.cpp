@@ -0,0 +1,134 @@
+#include "svg.h"
+#include "Point.h"
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+
+#if defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>
+#endif
+#endif
+
+SvgWriter::SvgWriter(std::ostream& out, double w, double h, double X, double Y, double scale)
+	: out(out), scale{scale}
+{
+	put(R"(<?xml version="1.0" encoding="UTF-8" standalone="no"?>)" "\n"
+		R"(<svg version = "1.1" )" "\n"
+		R"(baseProfile="full" )" "\n"
+		R"(xmlns = "http://www.w3.org/2000/svg" )" "\n"
+		R"(xmlns:xlink = "http://www.w3.org/1999/xlink" )" "\n"
+		R"(xmlns:ev = "http://www.w3.org/2001/xml-events" )" "\n"
+		R"(height = "5000px"  width = "5000px">)" "\n"
+		"\n"
+		R"(<g transform="translate()");
+	put(w / 2 + X); put(","); put(h / 2 + Y);
+	put(") scale("); put(scale); put(","); put(-scale);
+	put(")\"> \n");
+}
+
+SvgWriter::~SvgWriter()
+{
+	finish();
+}
+
+void SvgWriter::line(Point const& p, Point const& q, char const* color, double width)
+{
+	put(R"( <line x1=")"); put(p.x);
+	put(R"(" y1=")"); put(p.y);
+	put(R"(" x2=")"); put(q.x);
+	put(R"(" y2=")"); put(q.y);
+	put(R"(" style="stroke:)"); put(color);
+	put(";stroke-width:"); put(width / scale);
+	put("\"/> \n");
+}
+
+void SvgWriter::point(Point const& p, double rad)
+{
+	put(R"(<circle cx=")"); put(p.x);
+	put(R"(" cy=")"); put(p.y);
+	put(R"(" r=")"); put(rad / scale);
+	put("\"  fill=\"black\" />\n");
+}
+
+void SvgWriter::polygon(FaceRef face, char const* color, double opacity)
+{
+	put("<polygon points = \"");
+	auto ei = face->bounds;
+	auto end = ei;
+	do {
+		Point const& p = Org(ei)->point;
+		put(p.x); put(","); put(p.y); put(" ");
+		ei = ei.Lnext();
+	} while (ei != end);
+	put("\" style=\"fill:"); put(color);
+	put("; opacity:"); put(opacity);
+	put("; stroke-width:0\" />\n");
+}
+
+void SvgWriter::finish()
+{
+	if (finished) return;
+	put("\n</g>\n</svg>");
+	flush();
+	finished = true;
+}
+
+void SvgWriter::put(char const* s)
+{
+	std::size_t n = std::strlen(s);
+	if (used + n > sizeof buffer) {
+		flush();
+		if (n > sizeof buffer) {
+			out.write(s, n);
+			return;
+		}
+	}
+	std::memcpy(buffer + used, s, n);
+	used += n;
+}
+
+void SvgWriter::put(double x)
+{
+	// "%.6g" takes at most 13 characters for a double
+	if (sizeof buffer - used < 32)
+		flush();
+	char* first = buffer + used;
+	char* last = buffer + sizeof buffer;
+#ifdef __cpp_lib_to_chars
+	auto r = std::to_chars(first, last, x, std::chars_format::general, 6);
+	assert(r.ec == std::errc{});
+	used = r.ptr - buffer;
+#else
+	used += std::snprintf(first, last - first, "%.6g", x);
+#endif
+}
+
+void SvgWriter::flush()
+{
+	out.write(buffer, used);
+	used = 0;
+}
+
+void write_svg(std::ostream& out, Subdivision& dt, double w, double h, double X, double Y)
+{
+	SvgWriter svg(out, w, h, X, Y);
+
+	for (auto face = dt.faces.begin(); face != dt.faces.end(); ++face)
+	{
+		if (face == dt.outer_face || !face->mark) continue;
+		svg.polygon(face, "white", 0.25);
+	}
+	// each quad-edge once
+	for (auto qref = dt.edges.begin(); qref != dt.edges.end(); ++qref)
+	{
+		EdgeRef e(qref);
+		if (e.data().fixed)
+			svg.line(Org(e)->point, Dest(e)->point, "black", 2.0);
+		else if (Left(e)->mark || Right(e)->mark)
+			svg.line(Org(e)->point, Dest(e)->point, "black", 1.0);
+	}
+	for (Subdivision::Vertex const& v : dt.vertices)
+		svg.point(v.point, v.circumcenter ? 1.5 : 3.0);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include "Subdivision.h"
+#include <cstddef>
+#include <iosfwd>
+
+// SVG document written to a stream as it is drawn, through a fixed buffer;
+// numbers get 6 significant digits, as streams print them by default.
+// Shapes are in mesh coordinates: the picture is a group that scales them
+// by 'scale' (y up) and puts the origin in the middle of a w x h box at
+// (X, Y). finish (or the destructor) closes the document.
+class SvgWriter
+{
+public:
+	SvgWriter(std::ostream& out, double w, double h, double X = 0.0, double Y = 0.0,
+		double scale = 100.0);
+	~SvgWriter();
+	SvgWriter(SvgWriter const&) = delete;
+	SvgWriter& operator=(SvgWriter const&) = delete;
+
+	// widths and radii in pixels
+	void line(Point const& p, Point const& q, char const* color, double width);
+	void point(Point const& p, double rad);
+	void polygon(FaceRef face, char const* color, double opacity);
+	void finish();
+private:
+	void put(char const* s);
+	void put(double x);
+	void flush();
+
+	std::ostream& out;
+	double scale;
+	bool finished{};
+	std::size_t used{};
+	char buffer[1 << 16];
+};
+
+// The picture main writes: inner faces, every edge of an inner face or
+// fixed once (fixed ones thicker), vertices (circumcenters smaller).
+void write_svg(std::ostream& out, Subdivision& dt, double w, double h, double X, double Y);